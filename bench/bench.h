@@ -0,0 +1,46 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/bench.h
+// Version: 0
+//
+// Helpers shared by benchmarks.
+// Each benchmark is standalone executable that is built by build.sh against optimized copy of engine
+// and run by hand, printing its results as table to stdout.
+// Numbers only make sense relative to each other on same machine, so every benchmark measures
+// the thing it is about against baseline it is supposed to beat.
+#pragma once
+#include "lib/general.h"
+#include "lib/strings.h"
+#include "platform/os.h"
+
+// Prevents compiler from removing computation which result is not used otherwise
+#define BENCH_KEEP(_value) __asm__ volatile("" : : "r"(_value) : "memory")
+
+static u64 bench_random_state = 0x9E3779B97F4A7C15llu;
+
+// xorshift64*. Fast enough not to show up in measurements
+static u64
+bench_random(void) {
+    u64 x = bench_random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    bench_random_state = x;
+    return x * 0x2545F4914F6CDD1Dllu;
+}
+
+static void
+bench_seed(u64 seed) {
+    bench_random_state = seed ? seed : 0x9E3779B97F4A7C15llu;
+}
+
+static f64
+bench_seconds_since(u64 start_ns) {
+    return (f64)(os_get_nanoseconds() - start_ns) * 1e-9;
+}
+
+// Nanoseconds spent per single operation
+static f64
+bench_ns_per_op(u64 start_ns, u64 op_count) {
+    return (f64)(os_get_nanoseconds() - start_ns) / (f64)(op_count ? op_count : 1);
+}
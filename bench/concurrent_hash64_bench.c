@@ -0,0 +1,197 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/concurrent_hash64_bench.c
+// Version: 0
+//
+// Scaling of Concurrent_Hash64 from 1 to all cores, against Hash64 guarded by spin lock.
+// Each thread does same number of operations, so perfect scaling keeps ns per operation of
+// single thread and multiplies total throughput by thread count.
+// Workloads:
+// insert - threads insert disjoint keys into table that starts empty, so it is resized (migrated) many times
+// get - random lookups of present keys in table of BENCH_TABLE_KEY_COUNT keys
+// mixed - same table, 80% lookups and 20% updates of present keys
+#include "bench.h"
+#include "lib/hashing.h"
+
+#include <stdatomic.h>
+
+#define BENCH_MAX_THREADS 64
+#define BENCH_OPS_PER_THREAD (1 << 20)
+#define BENCH_INSERTS_PER_THREAD (1 << 18)
+#define BENCH_TABLE_KEY_COUNT (1 << 20)
+
+enum {
+    BENCH_WORKLOAD_INSERT,
+    BENCH_WORKLOAD_GET,
+    BENCH_WORKLOAD_MIXED,
+    BENCH_WORKLOAD_COUNT
+};
+
+static const char *BENCH_WORKLOAD_NAMES[] = { "insert", "get", "mixed" };
+
+enum {
+    BENCH_TABLE_LOCKED_HASH64,
+    BENCH_TABLE_CONCURRENT_HASH64,
+    BENCH_TABLE_COUNT
+};
+
+static Concurrent_Hash64 bench_concurrent_hash;
+static Hash64 bench_locked_hash;
+static _Atomic(u32) bench_lock;
+
+static void
+bench_spin_lock(void) {
+    u32 unlocked = 0;
+    while (!atomic_compare_exchange_weak_explicit(&bench_lock, &unlocked, 1,
+        memory_order_acquire, memory_order_relaxed)) {
+        unlocked = 0;
+    }
+}
+
+static void
+bench_spin_unlock(void) {
+    atomic_store_explicit(&bench_lock, 0, memory_order_release);
+}
+
+// Never 0 or (u64)-1, which are reserved by both tables
+static u64
+bench_key(u64 key_idx) {
+    return (hash64_mix(key_idx + 1) >> 1) | 1;
+}
+
+static void
+bench_set(u32 table, u64 key, u64 value) {
+    if (table == BENCH_TABLE_CONCURRENT_HASH64) {
+        concurrent_hash64_set(&bench_concurrent_hash, key, value);
+    } else {
+        bench_spin_lock();
+        hash64_set(&bench_locked_hash, key, value);
+        bench_spin_unlock();
+    }
+}
+
+static u64
+bench_get(u32 table, u64 key) {
+    u64 result;
+    if (table == BENCH_TABLE_CONCURRENT_HASH64) {
+        result = concurrent_hash64_get(&bench_concurrent_hash, key, 0);
+    } else {
+        bench_spin_lock();
+        result = hash64_get(&bench_locked_hash, key, 0);
+        bench_spin_unlock();
+    }
+    return result;
+}
+
+typedef struct {
+    u32 table;
+    u32 workload;
+    u32 thread_idx;
+} Bench_Thread_Data;
+
+static OS_THREAD_PROC_SIGNATURE(bench_thread_proc) {
+    Bench_Thread_Data *thread_data = data;
+    u32 table = thread_data->table;
+    if (thread_data->workload == BENCH_WORKLOAD_INSERT) {
+        u64 first_key_idx = (u64)thread_data->thread_idx * BENCH_INSERTS_PER_THREAD;
+        for (u32 op_idx = 0; op_idx < BENCH_INSERTS_PER_THREAD; ++op_idx) {
+            bench_set(table, bench_key(first_key_idx + op_idx), op_idx);
+        }
+    } else {
+        u64 state = hash64_mix(thread_data->thread_idx + 1);
+        u64 sum = 0;
+        for (u32 op_idx = 0; op_idx < BENCH_OPS_PER_THREAD; ++op_idx) {
+            state = state * 6364136223846793005llu + 1442695040888963407llu;
+            u64 key = bench_key((state >> 32) % BENCH_TABLE_KEY_COUNT);
+            if (thread_data->workload == BENCH_WORKLOAD_MIXED && (state >> 24) % 5 == 0) {
+                bench_set(table, key, op_idx);
+            } else {
+                sum += bench_get(table, key);
+            }
+        }
+        BENCH_KEEP(sum);
+    }
+}
+
+static void
+bench_init_table(u32 table, u32 workload) {
+    if (table == BENCH_TABLE_CONCURRENT_HASH64) {
+        init_concurrent_hash64(&bench_concurrent_hash, 0);
+    } else {
+        bench_locked_hash = create_hash64(0);
+    }
+    if (workload != BENCH_WORKLOAD_INSERT) {
+        for (u32 key_idx = 0; key_idx < BENCH_TABLE_KEY_COUNT; ++key_idx) {
+            bench_set(table, bench_key(key_idx), key_idx);
+        }
+    }
+}
+
+static void
+bench_destroy_table(u32 table) {
+    if (table == BENCH_TABLE_CONCURRENT_HASH64) {
+        destroy_concurrent_hash64(&bench_concurrent_hash);
+    } else {
+        destroy_hash64(&bench_locked_hash);
+    }
+}
+
+// Returns millions of operations per second, summed over all threads
+static f64
+bench_run(u32 table, u32 workload, u32 thread_count) {
+    bench_init_table(table, workload);
+    Bench_Thread_Data thread_data[BENCH_MAX_THREADS];
+    OS_Thread threads[BENCH_MAX_THREADS];
+    u64 start = os_get_nanoseconds();
+    for (u32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+        thread_data[thread_idx].table = table;
+        thread_data[thread_idx].workload = workload;
+        thread_data[thread_idx].thread_idx = thread_idx;
+        threads[thread_idx] = os_create_thread(bench_thread_proc, thread_data + thread_idx);
+    }
+    for (u32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+        os_join_thread(threads[thread_idx]);
+    }
+    u64 op_count = (u64)thread_count *
+        (workload == BENCH_WORKLOAD_INSERT ? BENCH_INSERTS_PER_THREAD : BENCH_OPS_PER_THREAD);
+    f64 result = 1000.0 / bench_ns_per_op(start, op_count);
+    bench_destroy_table(table);
+    return result;
+}
+
+int
+main(void) {
+    u32 max_thread_count = os_get_cpu_count();
+    if (max_thread_count > BENCH_MAX_THREADS) {
+        max_thread_count = BENCH_MAX_THREADS;
+    }
+
+    outf("Mops/s summed over threads, %u keys in get and mixed tables\n", BENCH_TABLE_KEY_COUNT);
+    outf("%8s |", "threads");
+    for (u32 workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload) {
+        outf(" %-21s |", BENCH_WORKLOAD_NAMES[workload]);
+    }
+    outf("\n%8s |", "");
+    for (u32 workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload) {
+        outf(" %10s %10s |", "locked", "concurrent");
+    }
+    outf("\n");
+    for (u32 thread_count = 1; thread_count <= max_thread_count;) {
+        outf("%8u |", thread_count);
+        for (u32 workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload) {
+            f64 locked = bench_run(BENCH_TABLE_LOCKED_HASH64, workload, thread_count);
+            f64 concurrent = bench_run(BENCH_TABLE_CONCURRENT_HASH64, workload, thread_count);
+            outf(" %10.2f %10.2f |", locked, concurrent);
+        }
+        outf("\n");
+        // Powers of two, and core count itself
+        if (thread_count == max_thread_count) {
+            break;
+        }
+        thread_count *= 2;
+        if (thread_count > max_thread_count) {
+            thread_count = max_thread_count;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/crc32_bench.c
+// Version: 0
+//
+// crc32 throughput of three implementations:
+// byte - single 256-entry table, byte at a time. This is what crc32 was before, copied here as baseline
+// slice8 - crc32_portable, slicing-by-8
+// crc32 - dispatching function, which uses carry-less multiplication (PCLMUL or PMULL) when available
+// Second table shows cost of crc32_combine, and cost of computing crc of whole buffer as crcs of
+// chunks which are then combined - which is what allows crc to be computed in parallel.
+// All results are checked against each other.
+#include "bench.h"
+#include "lib/hashing.h"
+#include "lib/memory.h"
+
+#define BENCH_BYTES_PER_MEASUREMENT (1 << 28)
+#define BENCH_MIN_SIZE 64
+#define BENCH_MAX_SIZE (16 << 20)
+#define BENCH_COMBINE_COUNT (1 << 16)
+#define BENCH_MIN_CHUNK_SIZE (4 << 10)
+
+static u32 bench_crc32_lut[256];
+
+static void
+bench_init_crc32_lut(void) {
+    for (u32 byte = 0; byte < 256; ++byte) {
+        u32 crc = byte << 24;
+        for (u32 bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+        bench_crc32_lut[byte] = crc;
+    }
+}
+
+static u32
+bench_crc32_byte(u32 crc, const void *bf_init, uptr bf_sz) {
+    const u8 *bf = bf_init;
+    while (bf_sz--) {
+        crc = (crc << 8) ^ bench_crc32_lut[((crc >> 24) ^ *bf++) & 0xFF];
+    }
+    return crc;
+}
+
+typedef u32 Bench_Crc32_Proc(u32 crc, const void *bf, uptr bf_sz);
+
+// Returns bytes per nanosecond (GB/s)
+static f64
+bench_crc32_proc(Bench_Crc32_Proc *proc, const u8 *bf, uptr bf_sz, u32 *crc_out) {
+    u32 repeat_count = BENCH_BYTES_PER_MEASUREMENT / bf_sz;
+    u32 crc = 0;
+    u64 start = os_get_nanoseconds();
+    for (u32 repeat_idx = 0; repeat_idx < repeat_count; ++repeat_idx) {
+        crc = proc(0, bf, bf_sz);
+        BENCH_KEEP(crc);
+    }
+    f64 ns = bench_ns_per_op(start, repeat_count);
+    *crc_out = crc;
+    return (f64)bf_sz / ns;
+}
+
+int
+main(void) {
+    bench_init_crc32_lut();
+    u8 *bf = mem_alloc_uninit(BENCH_MAX_SIZE);
+    for (uptr idx = 0; idx < BENCH_MAX_SIZE; ++idx) {
+        bf[idx] = (u8)bench_random();
+    }
+
+    outf("GB/s\n");
+    outf("%10s | %8s %8s %8s\n", "size", "byte", "slice8", "crc32");
+    for (uptr size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size *= 4) {
+        u32 byte_crc, slice8_crc, crc32_crc;
+        f64 byte_speed = bench_crc32_proc(bench_crc32_byte, bf, size, &byte_crc);
+        f64 slice8_speed = bench_crc32_proc(crc32_portable, bf, size, &slice8_crc);
+        f64 crc32_speed = bench_crc32_proc(crc32, bf, size, &crc32_crc);
+        if (byte_crc != slice8_crc || byte_crc != crc32_crc) {
+            outf("crc mismatch at size %llu: %08x %08x %08x\n", (unsigned long long)size,
+                byte_crc, slice8_crc, crc32_crc);
+            return 1;
+        }
+        outf("%10llu | %8.2f %8.2f %8.2f\n", (unsigned long long)size, byte_speed, slice8_speed, crc32_speed);
+    }
+
+    u64 sum = 0;
+    u64 start = os_get_nanoseconds();
+    for (u32 combine_idx = 0; combine_idx < BENCH_COMBINE_COUNT; ++combine_idx) {
+        sum += crc32_combine((u32)combine_idx, (u32)sum, BENCH_MIN_CHUNK_SIZE + combine_idx);
+    }
+    f64 combine_ns = bench_ns_per_op(start, BENCH_COMBINE_COUNT);
+    BENCH_KEEP(sum);
+    outf("\ncrc32_combine: %.2f ns per call\n", combine_ns);
+
+    u32 whole_crc = crc32(0, bf, BENCH_MAX_SIZE);
+    outf("crc of %uMB as crcs of chunks combined, GB/s\n", BENCH_MAX_SIZE >> 20);
+    outf("%10s | %8s\n", "chunk", "crc32");
+    for (uptr chunk_size = BENCH_MIN_CHUNK_SIZE; chunk_size <= BENCH_MAX_SIZE; chunk_size *= 4) {
+        u32 repeat_count = BENCH_BYTES_PER_MEASUREMENT / BENCH_MAX_SIZE;
+        u32 crc = 0;
+        start = os_get_nanoseconds();
+        for (u32 repeat_idx = 0; repeat_idx < repeat_count; ++repeat_idx) {
+            crc = crc32(0, bf, chunk_size);
+            for (uptr offset = chunk_size; offset < BENCH_MAX_SIZE; offset += chunk_size) {
+                crc = crc32_combine(crc, crc32(0, bf + offset, chunk_size), chunk_size);
+            }
+            BENCH_KEEP(crc);
+        }
+        f64 ns = bench_ns_per_op(start, repeat_count);
+        if (crc != whole_crc) {
+            outf("combined crc mismatch at chunk size %llu: %08x %08x\n", (unsigned long long)chunk_size,
+                crc, whole_crc);
+            return 1;
+        }
+        outf("%10llu | %8.2f\n", (unsigned long long)chunk_size, (f64)BENCH_MAX_SIZE / ns);
+    }
+
+    mem_free(bf, BENCH_MAX_SIZE);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/hash_bench.c
+// Version: 0
+//
+// hash_bytes (wyhash) against djb2, which hash_string used before, on inputs of 8B-64KB.
+// djb2 is copied here as baseline. It used to walk string up to zero terminator, here it gets
+// length instead, so both hashes do same amount of work apart from hashing itself.
+// Each input starts at different offset in random buffer, so result of previous call can't be reused
+// and unaligned loads are measured too.
+#include "bench.h"
+#include "lib/hashing.h"
+
+#define BENCH_BYTES_PER_MEASUREMENT (1 << 28)
+#define BENCH_MIN_HASH_COUNT (1 << 16)
+#define BENCH_MIN_SIZE 8
+#define BENCH_MAX_SIZE (64 << 10)
+#define BENCH_BUFFER_SIZE (BENCH_MAX_SIZE * 2)
+
+static u32
+djb2(const void *data, uptr size) {
+    const u8 *bytes = data;
+    u32 result = 5381;
+    for (uptr idx = 0; idx < size; ++idx) {
+        result = ((result << 5) + result) + bytes[idx];
+    }
+    return result;
+}
+
+int
+main(void) {
+    static u8 buffer[BENCH_BUFFER_SIZE];
+    for (uptr idx = 0; idx < BENCH_BUFFER_SIZE; ++idx) {
+        buffer[idx] = (u8)bench_random();
+    }
+
+    outf("%8s | %-21s | %-21s | %7s\n", "", "djb2", "wyhash", "");
+    outf("%8s | %10s %10s | %10s %10s | %7s\n", "size", "ns/hash", "GB/s", "ns/hash", "GB/s", "speedup");
+    for (uptr size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size *= 2) {
+        u32 hash_count = BENCH_BYTES_PER_MEASUREMENT / size;
+        if (hash_count < BENCH_MIN_HASH_COUNT) {
+            hash_count = BENCH_MIN_HASH_COUNT;
+        }
+        uptr offset_mask = BENCH_BUFFER_SIZE - size - 1;
+
+        u64 sum = 0;
+        u64 start = os_get_nanoseconds();
+        for (u32 hash_idx = 0; hash_idx < hash_count; ++hash_idx) {
+            sum += djb2(buffer + ((hash_idx * 61) & offset_mask), size);
+        }
+        f64 djb2_ns = bench_ns_per_op(start, hash_count);
+        BENCH_KEEP(sum);
+
+        sum = 0;
+        start = os_get_nanoseconds();
+        for (u32 hash_idx = 0; hash_idx < hash_count; ++hash_idx) {
+            sum += hash_bytes(buffer + ((hash_idx * 61) & offset_mask), size, HASH_DEFAULT_SEED);
+        }
+        f64 wyhash_ns = bench_ns_per_op(start, hash_count);
+        BENCH_KEEP(sum);
+
+        outf("%8llu | %10.2f %10.2f | %10.2f %10.2f | %6.2fx\n", (unsigned long long)size,
+            djb2_ns, (f64)size / djb2_ns, wyhash_ns, (f64)size / wyhash_ns, djb2_ns / wyhash_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/hash_map_bench.c
+// Version: 0
+//
+// Group_Hash64 (Swiss table design) against Hash64 (linear probing).
+// Both tables are created with same number of slots, from size that fits in L1 to size far beyond
+// last level cache, and filled up to given load factor. Measured per operation:
+// insert - filling table from empty, table is preallocated so there are no resizes
+// hit - lookup of present key, in random order
+// miss - lookup of key that is not in table. This is where probe length matters most
+// Both tables grow past load factor of 7/8, so it is the highest load factor that can be measured.
+#include "bench.h"
+#include "lib/hashing.h"
+#include "lib/memory.h"
+
+#define BENCH_LOOKUP_COUNT (1 << 22)
+#define BENCH_MIN_SLOTS_LOG2 10
+#define BENCH_MAX_SLOTS_LOG2 24
+
+enum {
+    BENCH_TABLE_HASH64,
+    BENCH_TABLE_GROUP_HASH64,
+    BENCH_TABLE_COUNT
+};
+
+static const f64 BENCH_LOAD_FACTORS[] = { 0.5, 0.6, 0.7, 0.8, 0.875 };
+
+typedef struct {
+    f64 insert_ns;
+    f64 hit_ns;
+    f64 miss_ns;
+} Bench_Result;
+
+static Bench_Result
+bench_hash64(u32 slot_count, u64 *keys, u32 key_count, u64 *hit_keys, u64 *miss_keys) {
+    Bench_Result result;
+    Hash64 hash = create_hash64(slot_count);
+    assert(hash.num_buckets == slot_count);
+
+    u64 start = os_get_nanoseconds();
+    for (u32 key_idx = 0; key_idx < key_count; ++key_idx) {
+        hash64_set(&hash, keys[key_idx], key_idx);
+    }
+    result.insert_ns = bench_ns_per_op(start, key_count);
+    assert(hash.num_buckets == slot_count);
+
+    u64 sum = 0;
+    start = os_get_nanoseconds();
+    for (u32 key_idx = 0; key_idx < BENCH_LOOKUP_COUNT; ++key_idx) {
+        sum += hash64_get(&hash, hit_keys[key_idx], 0);
+    }
+    result.hit_ns = bench_ns_per_op(start, BENCH_LOOKUP_COUNT);
+    BENCH_KEEP(sum);
+
+    sum = 0;
+    start = os_get_nanoseconds();
+    for (u32 key_idx = 0; key_idx < BENCH_LOOKUP_COUNT; ++key_idx) {
+        sum += hash64_get(&hash, miss_keys[key_idx], 0);
+    }
+    result.miss_ns = bench_ns_per_op(start, BENCH_LOOKUP_COUNT);
+    BENCH_KEEP(sum);
+
+    destroy_hash64(&hash);
+    return result;
+}
+
+static Bench_Result
+bench_group_hash64(u32 slot_count, u64 *keys, u32 key_count, u64 *hit_keys, u64 *miss_keys) {
+    Bench_Result result;
+    // create_group_hash64 reserves 8/7 of requested count
+    Group_Hash64 hash = create_group_hash64(slot_count / 8 * 7);
+    assert(hash.num_groups * HASH64_GROUP_SIZE == slot_count);
+
+    u64 start = os_get_nanoseconds();
+    for (u32 key_idx = 0; key_idx < key_count; ++key_idx) {
+        group_hash64_set(&hash, keys[key_idx], key_idx);
+    }
+    result.insert_ns = bench_ns_per_op(start, key_count);
+    assert(hash.num_groups * HASH64_GROUP_SIZE == slot_count);
+
+    u64 sum = 0;
+    start = os_get_nanoseconds();
+    for (u32 key_idx = 0; key_idx < BENCH_LOOKUP_COUNT; ++key_idx) {
+        sum += group_hash64_get(&hash, hit_keys[key_idx], 0);
+    }
+    result.hit_ns = bench_ns_per_op(start, BENCH_LOOKUP_COUNT);
+    BENCH_KEEP(sum);
+
+    sum = 0;
+    start = os_get_nanoseconds();
+    for (u32 key_idx = 0; key_idx < BENCH_LOOKUP_COUNT; ++key_idx) {
+        sum += group_hash64_get(&hash, miss_keys[key_idx], 0);
+    }
+    result.miss_ns = bench_ns_per_op(start, BENCH_LOOKUP_COUNT);
+    BENCH_KEEP(sum);
+
+    destroy_group_hash64(&hash);
+    return result;
+}
+
+int
+main(void) {
+    u32 max_key_count = (u32)((f64)(1u << BENCH_MAX_SLOTS_LOG2) * BENCH_LOAD_FACTORS[ARRAY_SIZE(BENCH_LOAD_FACTORS) - 1]);
+    u64 *keys = mem_alloc_uninit(max_key_count * sizeof(u64));
+    u64 *hit_keys = mem_alloc_uninit(BENCH_LOOKUP_COUNT * sizeof(u64));
+    u64 *miss_keys = mem_alloc_uninit(BENCH_LOOKUP_COUNT * sizeof(u64));
+    // xorshift does not repeat values within its period, so all keys are unique and nonzero,
+    // and keys generated after them are guaranteed to miss
+    for (u32 key_idx = 0; key_idx < max_key_count; ++key_idx) {
+        keys[key_idx] = bench_random();
+    }
+    for (u32 key_idx = 0; key_idx < BENCH_LOOKUP_COUNT; ++key_idx) {
+        miss_keys[key_idx] = bench_random();
+    }
+
+    outf("ns per operation, %u lookups per measurement\n", BENCH_LOOKUP_COUNT);
+    outf("%9s %6s | %-26s | %-26s | %-26s\n", "", "", "insert", "hit", "miss");
+    outf("%9s %6s | %12s %13s | %12s %13s | %12s %13s\n", "table", "load",
+        "hash64", "group_hash64", "hash64", "group_hash64", "hash64", "group_hash64");
+    for (u32 slots_log2 = BENCH_MIN_SLOTS_LOG2; slots_log2 <= BENCH_MAX_SLOTS_LOG2; slots_log2 += 2) {
+        u32 slot_count = 1u << slots_log2;
+        for (u32 load_idx = 0; load_idx < ARRAY_SIZE(BENCH_LOAD_FACTORS); ++load_idx) {
+            u32 key_count = (u32)((f64)slot_count * BENCH_LOAD_FACTORS[load_idx]);
+            for (u32 key_idx = 0; key_idx < BENCH_LOOKUP_COUNT; ++key_idx) {
+                hit_keys[key_idx] = keys[bench_random() % key_count];
+            }
+
+            Bench_Result results[BENCH_TABLE_COUNT];
+            results[BENCH_TABLE_HASH64] = bench_hash64(slot_count, keys, key_count, hit_keys, miss_keys);
+            results[BENCH_TABLE_GROUP_HASH64] = bench_group_hash64(slot_count, keys, key_count, hit_keys, miss_keys);
+            // Both tables take about 16 bytes per slot
+            outf("%7lluKB %6.3f | %12.2f %13.2f | %12.2f %13.2f | %12.2f %13.2f\n",
+                (unsigned long long)slot_count * 16 / 1024, BENCH_LOAD_FACTORS[load_idx],
+                results[BENCH_TABLE_HASH64].insert_ns, results[BENCH_TABLE_GROUP_HASH64].insert_ns,
+                results[BENCH_TABLE_HASH64].hit_ns, results[BENCH_TABLE_GROUP_HASH64].hit_ns,
+                results[BENCH_TABLE_HASH64].miss_ns, results[BENCH_TABLE_GROUP_HASH64].miss_ns);
+        }
+    }
+
+    mem_free(keys, max_key_count * sizeof(u64));
+    mem_free(hit_keys, BENCH_LOOKUP_COUNT * sizeof(u64));
+    mem_free(miss_keys, BENCH_LOOKUP_COUNT * sizeof(u64));
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/mem_alloc_bench.c
+// Version: 0
+//
+// Small allocation throughput of mem_alloc against malloc, for sizes 16-4096 bytes.
+// Patterns:
+// pairs - allocate and immediately free one block. Best case for any allocator
+// batch - allocate BENCH_BATCH_SIZE blocks and free them in shuffled order, so free lists get mixed
+// threads - batch pattern run on all cores at once, to see contention on shared state
+// mem_alloc_uninit is used, because malloc does not zero memory either
+#include "bench.h"
+#include "lib/memory.h"
+
+#include <stdlib.h> // malloc, free
+
+#define BENCH_OP_COUNT (1 << 20)
+#define BENCH_BATCH_SIZE 1024
+#define BENCH_MAX_THREADS 64
+
+enum {
+    BENCH_ALLOCATOR_MALLOC,
+    BENCH_ALLOCATOR_MEM_ALLOC,
+    BENCH_ALLOCATOR_COUNT
+};
+
+static const uptr BENCH_SIZES[] = { 16, 32, 48, 64, 128, 256, 512, 1024, 2048, 4096 };
+
+static void *
+bench_alloc(u32 allocator, uptr size) {
+    void *result = 0;
+    if (allocator == BENCH_ALLOCATOR_MALLOC) {
+        result = malloc(size);
+    } else {
+        result = mem_alloc_uninit(size);
+    }
+    // Touch memory, like any real user would
+    *(u8 *)result = 1;
+    return result;
+}
+
+static void
+bench_free(u32 allocator, void *ptr, uptr size) {
+    if (allocator == BENCH_ALLOCATOR_MALLOC) {
+        free(ptr);
+    } else {
+        mem_free(ptr, size);
+    }
+}
+
+static void
+bench_pairs(u32 allocator, uptr size, u32 op_count) {
+    for (u32 op_idx = 0; op_idx < op_count; ++op_idx) {
+        void *ptr = bench_alloc(allocator, size);
+        BENCH_KEEP(ptr);
+        bench_free(allocator, ptr, size);
+    }
+}
+
+static void
+bench_batches(u32 allocator, uptr size, u32 op_count, u32 *order) {
+    void *blocks[BENCH_BATCH_SIZE];
+    for (u32 op_idx = 0; op_idx < op_count; op_idx += BENCH_BATCH_SIZE) {
+        for (u32 block_idx = 0; block_idx < BENCH_BATCH_SIZE; ++block_idx) {
+            blocks[block_idx] = bench_alloc(allocator, size);
+        }
+        for (u32 block_idx = 0; block_idx < BENCH_BATCH_SIZE; ++block_idx) {
+            bench_free(allocator, blocks[order[block_idx]], size);
+        }
+    }
+}
+
+typedef struct {
+    u32 allocator;
+    uptr size;
+    u32 *order;
+} Bench_Thread_Data;
+
+static OS_THREAD_PROC_SIGNATURE(bench_thread_proc) {
+    Bench_Thread_Data *thread_data = data;
+    bench_batches(thread_data->allocator, thread_data->size, BENCH_OP_COUNT, thread_data->order);
+}
+
+// Returns nanoseconds per operation of each thread
+static f64
+bench_threads(u32 allocator, uptr size, u32 thread_count, u32 *order) {
+    Bench_Thread_Data thread_data;
+    thread_data.allocator = allocator;
+    thread_data.size = size;
+    thread_data.order = order;
+    OS_Thread threads[BENCH_MAX_THREADS];
+    u64 start = os_get_nanoseconds();
+    for (u32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+        threads[thread_idx] = os_create_thread(bench_thread_proc, &thread_data);
+    }
+    for (u32 thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+        os_join_thread(threads[thread_idx]);
+    }
+    return bench_ns_per_op(start, BENCH_OP_COUNT);
+}
+
+int
+main(void) {
+    static u32 order[BENCH_BATCH_SIZE];
+    for (u32 idx = 0; idx < BENCH_BATCH_SIZE; ++idx) {
+        order[idx] = idx;
+    }
+    for (u32 idx = BENCH_BATCH_SIZE - 1; idx > 0; --idx) {
+        u32 swap_idx = (u32)(bench_random() % (idx + 1));
+        u32 temp = order[idx];
+        order[idx] = order[swap_idx];
+        order[swap_idx] = temp;
+    }
+    u32 thread_count = os_get_cpu_count();
+    if (thread_count > BENCH_MAX_THREADS) {
+        thread_count = BENCH_MAX_THREADS;
+    }
+
+    outf("ns per alloc+free, %u operations, %u threads in threaded test\n", BENCH_OP_COUNT, thread_count);
+    outf("%6s | %-17s | %-17s | %-17s\n", "", "pairs", "batch", "threads");
+    outf("%6s | %8s %8s | %8s %8s | %8s %8s\n", "size", "malloc", "mem", "malloc", "mem", "malloc", "mem");
+    for (u32 size_idx = 0; size_idx < ARRAY_SIZE(BENCH_SIZES); ++size_idx) {
+        uptr size = BENCH_SIZES[size_idx];
+        f64 pairs_ns[BENCH_ALLOCATOR_COUNT];
+        f64 batch_ns[BENCH_ALLOCATOR_COUNT];
+        f64 threads_ns[BENCH_ALLOCATOR_COUNT];
+        for (u32 allocator = 0; allocator < BENCH_ALLOCATOR_COUNT; ++allocator) {
+            // Warm up, so first measurement does not include getting memory from os
+            bench_batches(allocator, size, BENCH_BATCH_SIZE * 4, order);
+
+            u64 start = os_get_nanoseconds();
+            bench_pairs(allocator, size, BENCH_OP_COUNT);
+            pairs_ns[allocator] = bench_ns_per_op(start, BENCH_OP_COUNT);
+
+            start = os_get_nanoseconds();
+            bench_batches(allocator, size, BENCH_OP_COUNT, order);
+            batch_ns[allocator] = bench_ns_per_op(start, BENCH_OP_COUNT);
+
+            threads_ns[allocator] = bench_threads(allocator, size, thread_count, order);
+        }
+        outf("%6llu | %8.2f %8.2f | %8.2f %8.2f | %8.2f %8.2f\n", (unsigned long long)size,
+            pairs_ns[BENCH_ALLOCATOR_MALLOC], pairs_ns[BENCH_ALLOCATOR_MEM_ALLOC],
+            batch_ns[BENCH_ALLOCATOR_MALLOC], batch_ns[BENCH_ALLOCATOR_MEM_ALLOC],
+            threads_ns[BENCH_ALLOCATOR_MALLOC], threads_ns[BENCH_ALLOCATOR_MEM_ALLOC]);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/radix_sort_bench.c
+// Version: 0
+//
+// radix_sort against radix sort it replaced, which built histogram of each 8-bit digit in separate pass
+// over array and always did all 4 scatter passes. Old version is copied here as baseline.
+// Inputs of 1k-10M entries:
+// uniform - random 32-bit keys
+// nearly sorted - sorted keys, with 1% of entries swapped with random others
+// few distinct - keys in range [0, 16), like layer or material ids. High digits are constant, so
+//   their passes are skipped
+// Both sorts are stable, so their results are checked to be identical.
+#include "bench.h"
+#include "lib/memory.h"
+#include "lib/sorting.h"
+
+#define BENCH_ENTRIES_PER_MEASUREMENT (1 << 25)
+#define BENCH_MAX_ENTRY_COUNT 10000000
+#define BENCH_FEW_DISTINCT_KEY_COUNT 16
+#define BENCH_NEARLY_SORTED_SWAP_DEN 100
+
+enum {
+    BENCH_INPUT_UNIFORM,
+    BENCH_INPUT_NEARLY_SORTED,
+    BENCH_INPUT_FEW_DISTINCT,
+    BENCH_INPUT_COUNT
+};
+
+static const char *BENCH_INPUT_NAMES[] = { "uniform", "nearly sorted", "few distinct" };
+static const uptr BENCH_ENTRY_COUNTS[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+static void
+bench_radix_sort_baseline(SortEntry *entries, SortEntry *sort_temp, uptr n) {
+    SortEntry *src = entries;
+    SortEntry *dst = sort_temp;
+    for (u32 byte_idx = 0; byte_idx < 32; byte_idx += 8) {
+        u32 sort_key_offsets[256] = {0};
+        for (u32 i = 0; i < n; ++i) {
+            u32 radix_value = src[i].key;
+            u32 radix_piece = (radix_value >> byte_idx) & 0xFF;
+            ++sort_key_offsets[radix_piece];
+        }
+
+        u32 total = 0;
+        for (u32 sort_key_idx = 0; sort_key_idx < ARRAY_SIZE(sort_key_offsets); ++sort_key_idx) {
+            u32 count = sort_key_offsets[sort_key_idx];
+            sort_key_offsets[sort_key_idx] = total;
+            total += count;
+        }
+
+        for (u32 i = 0; i < n; ++i) {
+            u32 radix_value = src[i].key;
+            u32 radix_piece = (radix_value >> byte_idx) & 0xFF;
+            dst[sort_key_offsets[radix_piece]++] = src[i];
+        }
+
+        SortEntry *temp = dst;
+        dst = src;
+        src = temp;
+    }
+}
+
+static void
+bench_fill_input(SortEntry *entries, uptr n, u32 input) {
+    for (uptr idx = 0; idx < n; ++idx) {
+        u32 key;
+        if (input == BENCH_INPUT_UNIFORM) {
+            key = (u32)bench_random();
+        } else if (input == BENCH_INPUT_NEARLY_SORTED) {
+            key = (u32)((u64)idx * 0xFFFFFFFFllu / n);
+        } else {
+            key = (u32)(bench_random() % BENCH_FEW_DISTINCT_KEY_COUNT);
+        }
+        entries[idx].key = key;
+        entries[idx].value = (u32)idx;
+    }
+    if (input == BENCH_INPUT_NEARLY_SORTED) {
+        for (uptr swap_idx = 0; swap_idx < n / BENCH_NEARLY_SORTED_SWAP_DEN; ++swap_idx) {
+            uptr a = bench_random() % n;
+            uptr b = bench_random() % n;
+            u32 temp = entries[a].key;
+            entries[a].key = entries[b].key;
+            entries[b].key = temp;
+        }
+    }
+}
+
+typedef void Bench_Sort_Proc(SortEntry *entries, SortEntry *temp, uptr n);
+
+// Returns nanoseconds per entry. Array is restored from input before each sort, which is not measured.
+// First sort is warm-up and is not measured either
+static f64
+bench_sort(Bench_Sort_Proc *proc, const SortEntry *input, SortEntry *entries, SortEntry *temp, uptr n) {
+    u32 repeat_count = BENCH_ENTRIES_PER_MEASUREMENT / n;
+    if (repeat_count < 1) {
+        repeat_count = 1;
+    }
+    u64 total_ns = 0;
+    for (u32 repeat_idx = 0; repeat_idx <= repeat_count; ++repeat_idx) {
+        mem_copy(entries, input, n * sizeof(SortEntry));
+        u64 start = os_get_nanoseconds();
+        proc(entries, temp, n);
+        if (repeat_idx) {
+            total_ns += os_get_nanoseconds() - start;
+        }
+    }
+    return (f64)total_ns / ((f64)n * repeat_count);
+}
+
+int
+main(void) {
+    uptr size = BENCH_MAX_ENTRY_COUNT * sizeof(SortEntry);
+    SortEntry *input = mem_alloc_uninit(size);
+    SortEntry *entries = mem_alloc_uninit(size);
+    SortEntry *temp = mem_alloc_uninit(size);
+    SortEntry *expected = mem_alloc_uninit(size);
+
+    outf("ns per entry\n");
+    outf("%9s | %-21s | %-21s | %-21s |\n", "", BENCH_INPUT_NAMES[0], BENCH_INPUT_NAMES[1], BENCH_INPUT_NAMES[2]);
+    outf("%9s |", "entries");
+    for (u32 input_kind = 0; input_kind < BENCH_INPUT_COUNT; ++input_kind) {
+        outf(" %10s %10s |", "baseline", "radix_sort");
+    }
+    outf("\n");
+    for (u32 count_idx = 0; count_idx < ARRAY_SIZE(BENCH_ENTRY_COUNTS); ++count_idx) {
+        uptr n = BENCH_ENTRY_COUNTS[count_idx];
+        outf("%9llu |", (unsigned long long)n);
+        for (u32 input_kind = 0; input_kind < BENCH_INPUT_COUNT; ++input_kind) {
+            bench_fill_input(input, n, input_kind);
+            f64 baseline_ns = bench_sort(bench_radix_sort_baseline, input, entries, temp, n);
+            mem_copy(expected, entries, n * sizeof(SortEntry));
+            f64 radix_ns = bench_sort(radix_sort, input, entries, temp, n);
+            for (uptr idx = 0; idx < n; ++idx) {
+                if (entries[idx].key != expected[idx].key || entries[idx].value != expected[idx].value) {
+                    outf("\nresult mismatch at %llu of %llu entries, %s input\n", (unsigned long long)idx,
+                        (unsigned long long)n, BENCH_INPUT_NAMES[input_kind]);
+                    return 1;
+                }
+            }
+            outf(" %10.2f %10.2f |", baseline_ns, radix_ns);
+        }
+        outf("\n");
+    }
+
+    mem_free(input, size);
+    mem_free(entries, size);
+    mem_free(temp, size);
+    mem_free(expected, size);
+    return 0;
+}
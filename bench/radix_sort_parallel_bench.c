@@ -0,0 +1,102 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/radix_sort_parallel_bench.c
+// Version: 0
+//
+// Scaling of radix_sort_parallel from 1 to all cores on 1M-50M entries with random keys.
+// Thread count includes thread that calls sort, so work queue is created with one worker less.
+// Speedup is measured against single-threaded radix_sort, and results of both are checked to be identical.
+#include "bench.h"
+#include "lib/memory.h"
+#include "lib/sorting.h"
+#include "lib/work_queue.h"
+
+#define BENCH_ENTRIES_PER_MEASUREMENT (1 << 26)
+#define BENCH_MAX_ENTRY_COUNT 50000000
+
+static const uptr BENCH_ENTRY_COUNTS[] = { 1000000, 10000000, 50000000 };
+
+// Returns nanoseconds per entry. Array is restored from input before each sort, which is not measured.
+// First sort is warm-up and is not measured either
+static f64
+bench_sort(Work_Queue *queue, const SortEntry *input, SortEntry *entries, SortEntry *temp, uptr n) {
+    u32 repeat_count = BENCH_ENTRIES_PER_MEASUREMENT / n;
+    if (repeat_count < 1) {
+        repeat_count = 1;
+    }
+    u64 total_ns = 0;
+    for (u32 repeat_idx = 0; repeat_idx <= repeat_count; ++repeat_idx) {
+        mem_copy(entries, input, n * sizeof(SortEntry));
+        u64 start = os_get_nanoseconds();
+        if (queue) {
+            radix_sort_parallel(queue, entries, temp, n);
+        } else {
+            radix_sort(entries, temp, n);
+        }
+        if (repeat_idx) {
+            total_ns += os_get_nanoseconds() - start;
+        }
+    }
+    return (f64)total_ns / ((f64)n * repeat_count);
+}
+
+int
+main(void) {
+    u32 max_thread_count = os_get_cpu_count();
+    if (max_thread_count > WORK_QUEUE_MAX_THREADS + 1) {
+        max_thread_count = WORK_QUEUE_MAX_THREADS + 1;
+    }
+    uptr size = BENCH_MAX_ENTRY_COUNT * sizeof(SortEntry);
+    SortEntry *input = mem_alloc_uninit(size);
+    SortEntry *entries = mem_alloc_uninit(size);
+    SortEntry *temp = mem_alloc_uninit(size);
+    SortEntry *expected = mem_alloc_uninit(size);
+    // Pages are mapped on first write. Without touching them here, page faults would be measured
+    // as part of whichever sort runs first
+    mem_zero(entries, size);
+    mem_zero(temp, size);
+
+    outf("ns per entry, speedup relative to radix_sort\n");
+    for (u32 count_idx = 0; count_idx < ARRAY_SIZE(BENCH_ENTRY_COUNTS); ++count_idx) {
+        uptr n = BENCH_ENTRY_COUNTS[count_idx];
+        for (uptr idx = 0; idx < n; ++idx) {
+            input[idx].key = (u32)bench_random();
+            input[idx].value = (u32)idx;
+        }
+        f64 radix_ns = bench_sort(0, input, entries, temp, n);
+        mem_copy(expected, entries, n * sizeof(SortEntry));
+        outf("\n%llu entries, radix_sort %.2f\n", (unsigned long long)n, radix_ns);
+        outf("%8s | %8s %8s\n", "threads", "ns", "speedup");
+
+        for (u32 thread_count = 1; thread_count <= max_thread_count;) {
+            Work_Queue *queue = mem_alloc(sizeof(Work_Queue));
+            init_work_queue(queue, thread_count - 1);
+            f64 parallel_ns = bench_sort(queue, input, entries, temp, n);
+            shutdown_work_queue(queue);
+            mem_free(queue, sizeof(Work_Queue));
+            for (uptr idx = 0; idx < n; ++idx) {
+                if (entries[idx].key != expected[idx].key || entries[idx].value != expected[idx].value) {
+                    outf("result mismatch at %llu of %llu entries, %u threads\n", (unsigned long long)idx,
+                        (unsigned long long)n, thread_count);
+                    return 1;
+                }
+            }
+            outf("%8u | %8.2f %7.2fx\n", thread_count, parallel_ns, radix_ns / parallel_ns);
+
+            // Powers of two, and core count itself
+            if (thread_count == max_thread_count) {
+                break;
+            }
+            thread_count *= 2;
+            if (thread_count > max_thread_count) {
+                thread_count = max_thread_count;
+            }
+        }
+    }
+
+    mem_free(input, size);
+    mem_free(entries, size);
+    mem_free(temp, size);
+    mem_free(expected, size);
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: bench/read_ahead_bench.c
+// Version: 0
+//
+// Parsing of large text asset through read ahead stream against synchronous file stream.
+// Asset is BENCH_FILE_SIZE bytes of vertex lines like 'v 1.250 -3.500 12.125', which are parsed
+// into numbers, so there is parsing work for file reads to overlap with.
+// Right after file is generated it is in os page cache, so reads only copy memory. To measure
+// reads from disk, drop page cache (purge on macos, /proc/sys/vm/drop_caches on linux) and run
+// with mode name as argument - then existing file is parsed only in that mode:
+//   read_ahead_bench [sync|read_ahead]
+#include "bench.h"
+#include "lib/memory.h"
+#include "lib/stream.h"
+
+#define BENCH_FILENAME "read_ahead_bench.txt"
+#define BENCH_FILE_SIZE (256 << 20)
+#define BENCH_BUFFER_SIZE (64 << 10)
+// Lines are much shorter than that, so whole line is always in buffer after advance
+#define BENCH_MAX_LINE_SIZE (4 << 10)
+#define BENCH_CHUNK_COUNT 4
+#define BENCH_CHUNK_SIZE (1 << 20)
+
+enum {
+    BENCH_MODE_SYNC,
+    BENCH_MODE_READ_AHEAD,
+    BENCH_MODE_COUNT
+};
+
+static const char *BENCH_MODE_NAMES[] = { "sync", "read_ahead" };
+
+typedef struct {
+    u64 line_count;
+    f64 sum;
+} Bench_Parse_Result;
+
+static bool
+bench_generate_file(void) {
+    OS_File_Handle file = {0};
+    os_open_file(&file, BENCH_FILENAME, FILE_MODE_WRITE);
+    bool result = OS_IS_FILE_VALID(&file);
+    if (result) {
+        u8 *bf = mem_alloc_uninit(BENCH_BUFFER_SIZE);
+        OutStream stream;
+        init_out_streamf(&stream, &file, bf, BENCH_BUFFER_SIZE, BENCH_BUFFER_SIZE - BENCH_MAX_LINE_SIZE);
+        uptr size = 0;
+        while (size < BENCH_FILE_SIZE) {
+            size += out_streamf(&stream, "v %d.%03u %d.%03u %d.%03u\n",
+                (i32)(bench_random() % 2001) - 1000, (u32)(bench_random() % 1000),
+                (i32)(bench_random() % 2001) - 1000, (u32)(bench_random() % 1000),
+                (i32)(bench_random() % 2001) - 1000, (u32)(bench_random() % 1000));
+        }
+        destroy_out_stream(&stream);
+        // Failed writes don't advance file position
+        result = stream.file_idx >= BENCH_FILE_SIZE;
+        os_close_file(&file);
+        mem_free(bf, BENCH_BUFFER_SIZE);
+    }
+    return result;
+}
+
+static f64
+bench_parse_number(const u8 **cursor_ptr, const u8 *end) {
+    const u8 *cursor = *cursor_ptr;
+    while (cursor < end && *cursor == ' ') {
+        ++cursor;
+    }
+    bool is_negative = cursor < end && *cursor == '-';
+    if (is_negative) {
+        ++cursor;
+    }
+    f64 result = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        result = result * 10 + (*cursor++ - '0');
+    }
+    if (cursor < end && *cursor == '.') {
+        ++cursor;
+        f64 scale = 0.1;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            result += (*cursor++ - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    *cursor_ptr = cursor;
+    return is_negative ? -result : result;
+}
+
+static Bench_Parse_Result
+bench_parse(InStream *stream) {
+    Bench_Parse_Result result = {0};
+    for (;;) {
+        const u8 *data;
+        uptr size = in_stream_peek_ptr(stream, &data);
+        if (!size) {
+            break;
+        }
+        uptr line_size = 0;
+        while (line_size < size && data[line_size] != '\n') {
+            ++line_size;
+        }
+        const u8 *cursor = data;
+        const u8 *line_end = data + line_size;
+        if (line_size && *cursor == 'v') {
+            ++cursor;
+            while (cursor < line_end) {
+                result.sum += bench_parse_number(&cursor, line_end);
+                // Skip anything that is not number
+                while (cursor < line_end && *cursor != ' ') {
+                    ++cursor;
+                }
+            }
+            ++result.line_count;
+        }
+        in_stream_advance(stream, line_size < size ? line_size + 1 : size);
+    }
+    return result;
+}
+
+// Returns seconds spent opening and parsing file
+static f64
+bench_run(u32 mode, Bench_Parse_Result *result) {
+    u8 *bf = mem_alloc_uninit(BENCH_BUFFER_SIZE);
+    u8 *chunk_bf = mem_alloc_uninit(BENCH_CHUNK_COUNT * BENCH_CHUNK_SIZE);
+    u64 start = os_get_nanoseconds();
+    OS_File_Handle file = {0};
+    os_open_file(&file, BENCH_FILENAME, FILE_MODE_READ);
+    InStream stream;
+    In_Stream_Read_Ahead read_ahead;
+    if (mode == BENCH_MODE_READ_AHEAD) {
+        init_in_stream_read_ahead(&stream, &read_ahead, &file, bf, BENCH_BUFFER_SIZE,
+            BENCH_BUFFER_SIZE - BENCH_MAX_LINE_SIZE, chunk_bf, BENCH_CHUNK_COUNT * BENCH_CHUNK_SIZE,
+            BENCH_CHUNK_COUNT);
+    } else {
+        init_in_streamf(&stream, &file, bf, BENCH_BUFFER_SIZE, BENCH_BUFFER_SIZE - BENCH_MAX_LINE_SIZE);
+    }
+    *result = bench_parse(&stream);
+    destroy_in_stream(&stream);
+    os_close_file(&file);
+    f64 seconds = bench_seconds_since(start);
+    mem_free(bf, BENCH_BUFFER_SIZE);
+    mem_free(chunk_bf, BENCH_CHUNK_COUNT * BENCH_CHUNK_SIZE);
+    return seconds;
+}
+
+int
+main(int argc, char **argv) {
+    u32 first_mode = 0;
+    u32 last_mode = BENCH_MODE_COUNT - 1;
+    if (argc > 1) {
+        for (u32 mode = 0; mode < BENCH_MODE_COUNT; ++mode) {
+            if (str_eq(argv[1], BENCH_MODE_NAMES[mode])) {
+                first_mode = last_mode = mode;
+            }
+        }
+    }
+
+    // Opening file that does not exist breaks into debugger, so check first
+    bool has_file = false;
+    if (os_file_exists(BENCH_FILENAME)) {
+        OS_File_Handle existing = {0};
+        os_open_file(&existing, BENCH_FILENAME, FILE_MODE_READ);
+        has_file = OS_IS_FILE_VALID(&existing) && os_get_file_size(&existing) >= BENCH_FILE_SIZE;
+        os_close_file(&existing);
+    }
+    if (argc == 1 || !has_file) {
+        outf("generating %uMB file %s\n", BENCH_FILE_SIZE >> 20, BENCH_FILENAME);
+        if (!bench_generate_file()) {
+            outf("failed to write %s\n", BENCH_FILENAME);
+            return 1;
+        }
+    }
+
+    Bench_Parse_Result results[BENCH_MODE_COUNT];
+    outf("%10s | %8s %8s %10s\n", "mode", "seconds", "MB/s", "lines");
+    for (u32 mode = first_mode; mode <= last_mode; ++mode) {
+        f64 seconds = bench_run(mode, results + mode);
+        outf("%10s | %8.3f %8.1f %10llu\n", BENCH_MODE_NAMES[mode], seconds,
+            (f64)BENCH_FILE_SIZE / (1 << 20) / seconds, (unsigned long long)results[mode].line_count);
+    }
+    if (first_mode != last_mode && (results[BENCH_MODE_SYNC].line_count != results[BENCH_MODE_READ_AHEAD].line_count ||
+        results[BENCH_MODE_SYNC].sum != results[BENCH_MODE_READ_AHEAD].sum)) {
+        outf("parse results of modes differ\n");
+        return 1;
+    }
+    return 0;
+}
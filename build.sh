@@ -26,4 +26,15 @@ touch build/lock.tmp
 clang -g $build_options $frameworks -DCOMPILE_ENGINE -o build/engine.dylib -dynamiclib $vulkan_lib $engine_filenames
 clang -g $build_options -o build/game.dylib -dynamiclib build/engine.dylib $game_filenames
 clang -g $build_options -o build/game build/engine.dylib $main_filenames
-rm build/lock.tmp
\ No newline at end of file
+rm build/lock.tmp
+# Tests. Each test is standalone executable that returns nonzero on failure, built against debug engine
+for test_filename in tests/*.c; do
+    test_name=build/$(basename $test_filename .c)
+    clang -g $build_options -o $test_name build/engine.dylib $test_filename && ./$test_name
+done
+# Benchmarks. Engine is built again with optimizations, so results are not skewed by -O0
+bench_options="-O2 -DMEMORY_TRACKING=0 -std=c11 -fno-exceptions -Iengine -I$vulkan_path/include -Ithirdparty $error_policy"
+clang -g $bench_options $frameworks -DCOMPILE_ENGINE -o build/engine_bench.dylib -dynamiclib $vulkan_lib $engine_filenames
+for bench_filename in bench/*.c; do
+    clang -g $bench_options -o build/$(basename $bench_filename .c) build/engine_bench.dylib $bench_filename
+done
@@ -6,4 +6,22 @@ uptr
 engine_ctx_fmt_local_filepath(char *bf, uptr bf_sz, 
     Engine_Ctx *ctx, const char *local_path) {
     return fmt(bf, bf_sz, "%s/%s", ctx->executable_folder, local_path);
+}
+
+void 
+engine_ctx_begin_frame(Engine_Ctx *ctx) {
+    mem_begin_frame();
+    ++ctx->frame_index;
+    ctx->frame_arena = ctx->frame_arenas + (ctx->frame_index & 1);
+    arena_reset(ctx->frame_arena);
+}
+
+void 
+engine_ctx_shutdown(Engine_Ctx *ctx) {
+    shutdown_work_queue(&ctx->work_queue);
+    for (u32 i = 0; i < ARRAY_SIZE(ctx->frame_arenas); ++i) {
+        arena_clear(ctx->frame_arenas + i);
+    }
+    destroy_string_table(&ctx->strings);
+    arena_clear(&ctx->arena);
 }
\ No newline at end of file
@@ -35,6 +35,9 @@ Otherwise there should be two platform APIs: One for game layer, other for platf
 */
 #pragma once 
 #include "lib/general.h"
+#include "lib/memory.h"
+#include "lib/string_table.h"
+#include "lib/work_queue.h"
 
 #include "platform/os.h"
 #include "platform/window.h"
@@ -43,6 +46,17 @@ Otherwise there should be two platform APIs: One for game layer, other for platf
 
 typedef struct {
     void *game_data; 
+    // Storage for everything that lives until engine shutdown
+    Memory_Arena arena;
+    // Scratch memory for current frame. Arenas are swapped and reset in the beginning of each frame,
+    // so anything allocated during frame stays valid until the end of the next one
+    Memory_Arena frame_arenas[2];
+    u32 frame_index;
+    Memory_Arena *frame_arena;
+    // Interned filenames, symbol names and other strings that are compared often
+    String_Table strings;
+    // Worker threads for jobs that can be split between cores (sorting, asset processing etc.)
+    Work_Queue work_queue;
     
     char *executable_folder;
     
@@ -54,6 +68,9 @@ typedef struct {
 
 uptr engine_ctx_fmt_local_filepath(char *bf, uptr bf_sz, 
     Engine_Ctx *ctx, const char *local_path);
+// Swap and reset frame arenas. Called by engine at the top of the main loop
+void engine_ctx_begin_frame(Engine_Ctx *ctx);
+void engine_ctx_shutdown(Engine_Ctx *ctx);
 
 #define GAME_UPDATE_SIGNATURE(_name) bool _name(Engine_Ctx *ctx)
 typedef GAME_UPDATE_SIGNATURE(Game_Update_Func);
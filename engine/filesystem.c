@@ -1,12 +1,14 @@
 #include "filesystem.h"
 #include "lib/hashing.h"
 #include "lib/strings.h"
+#include "lib/pool.h"
+#include "lib/string_table.h"
 
 #define FS_HASH_SIZE 128
 
 typedef struct FS_File_Slot {
     u64 hash;
-    char *name; // @TODO Filepath should be here
+    String_ID name; // @TODO Filepath should be here
     bool is_open;
     u32 file_mode;
     uptr file_size_cached;
@@ -20,11 +22,13 @@ typedef struct FS_Filepath_Slot {
 } FSFilepathSlot;
 
 typedef struct FS_Ctx {
+    Memory_Arena *arena;
+    // Filenames are interned, so reopening file does not store its name again
+    struct String_Table *strings;
+    
+    // Maps filename hash to handle in file_slots
     Hash64 file_hash;
-    u64 nfile_slots;
-    u64 nfile_slots_used;
-    FS_File_Slot *file_hash_slots;
-    // @TODO Free list for ids
+    Pool file_slots;
     
     Hash64 filepath_hash;
     u64 nfilepath_slots;
@@ -35,16 +39,16 @@ typedef struct FS_Ctx {
 static FS_Ctx *fs;
 
 struct FS_Ctx *
-create_filesystem(void) {
-    struct FS_Ctx *ctx_local = mem_alloc(sizeof(FS_Ctx));
+create_filesystem(Memory_Arena *arena, struct String_Table *strings) {
+    struct FS_Ctx *ctx_local = arena_push_struct(arena, FS_Ctx);
     init_filesystem(ctx_local);
-    fs->nfile_slots = FS_HASH_SIZE;
-    fs->file_hash = create_hash64(fs->nfile_slots);
-    fs->file_hash_slots = mem_alloc_arr(fs->nfile_slots, FS_File_Slot);
+    fs->arena = arena;
+    fs->strings = strings;
+    fs->file_hash = create_hash64(FS_HASH_SIZE);
+    init_pool_typed(&fs->file_slots, arena, FS_File_Slot, FS_HASH_SIZE);
     fs->nfilepath_slots = FS_HASH_SIZE;
     fs->filepath_hash = create_hash64(fs->nfilepath_slots);
-    fs->filepath_hash_slots = mem_alloc_arr(fs->nfilepath_slots, FSFilepathSlot);
-    fs->nfile_slots_used++;
+    fs->filepath_hash_slots = arena_push_arr(arena, FSFilepathSlot, fs->nfilepath_slots);
     fs->nfilepath_slots_used++;
     return ctx_local;
 }
@@ -61,13 +65,9 @@ is_file_id_valid(File_ID id) {
 
 static FS_File_Slot *
 get_slot(u64 hash) {
-    FS_File_Slot *slot = 0;
-    u64 default_value = (u64)-1;
-    u64 idx = hash64_get(&fs->file_hash, hash, default_value);
-    if (idx != default_value) {
-        assert(idx < FS_HASH_SIZE);
-        slot = fs->file_hash_slots + idx;
-    }
+    Pool_Handle handle;
+    handle.value = hash64_get(&fs->file_hash, hash, 0);
+    FS_File_Slot *slot = pool_get_typed(&fs->file_slots, FS_File_Slot, handle);
     return slot;
 }
 
@@ -77,16 +77,10 @@ get_hash_for_filename(const char *filename) {
     return hash_string(filename);
 }
 
-static u64 
-get_new_file_slot_idx(void) {
-    assert(fs->nfile_slots_used < fs->nfile_slots);
-    return fs->nfile_slots_used++;
-}
-
 static void 
 open_slot_file(FS_File_Slot *slot) {
     if (!slot->is_open) {
-        os_open_file(&slot->handle, slot->name, slot->file_mode);
+        os_open_file(&slot->handle, string_table_str(fs->strings, slot->name), slot->file_mode);
         slot->is_open = true;
     }
 }
@@ -124,13 +118,13 @@ fs_open_file(const char *name, u32 mode) {
         // @TODO(hl): Error reporting
         // report_error_general("File is already open: '%s'", name);
     } else {
-        u64 new_slot_idx = get_new_file_slot_idx();
-        if (new_slot_idx != (u64)-1) {
-            hash64_set(&fs->file_hash, hash, new_slot_idx);
-            slot = fs->file_hash_slots + new_slot_idx;
+        Pool_Handle slot_handle = pool_alloc(&fs->file_slots);
+        assert(slot_handle.value);
+        if (slot_handle.value) {
+            hash64_set(&fs->file_hash, hash, slot_handle.value);
+            slot = pool_get_typed(&fs->file_slots, FS_File_Slot, slot_handle);
             slot->hash = hash;
-            // @LEAK
-            slot->name = mem_alloc_str(name);
+            slot->name = intern_string(fs->strings, name);
             slot->file_mode = mode;
             open_slot_file(slot);
             slot->file_size_cached = (u64)-1;
@@ -152,11 +146,13 @@ fs_close_file(File_ID id) {
         // report_error_general("No file open for file id %llu (%s)", id.value, bf);
     } else {
         os_close_file(&slot->handle);
-        slot->is_open = false;
-        hash64_set(&fs->file_hash, slot->hash, -1);
-        slot->hash = 0;
+        Pool_Handle slot_handle;
+        slot_handle.value = hash64_get(&fs->file_hash, slot->hash, 0);
+        hash64_delete(&fs->file_hash, slot->hash);
+        pool_free(&fs->file_slots, slot_handle);
+        result = true;
         // @TODO Think about policy for closed files - do we want to have some of their contents
-        // cached, shoul we free the slot or leave it for information...
+        // cached
     }
     return result;
 }
@@ -179,7 +175,7 @@ fs_fmt_filename(char *bf, uptr bf_sz, File_ID id) {
     uptr result = 0;
     FS_File_Slot *slot = get_slot(id.value);
     if (slot) {
-        result = str_cp(bf, bf_sz, slot->name);
+        result = str_cp(bf, bf_sz, string_table_str(fs->strings, slot->name));
     }
     return result;    
 }
@@ -21,13 +21,14 @@
 #include "lib/memory.h"
 
 struct FS_Ctx;
+struct String_Table;
 
 typedef struct {
     u64 value;
 } File_ID;
 
 
-ENGINE_PUB struct FS_Ctx *create_filesystem(void);
+ENGINE_PUB struct FS_Ctx *create_filesystem(Memory_Arena *arena, struct String_Table *strings);
 ENGINE_PUB void init_filesystem(struct FS_Ctx *ctx);
 
 // id.value != 0
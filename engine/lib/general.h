@@ -115,6 +115,15 @@ typedef _Bool bool;
 
 #define UNUSED(_var) (void)(_var)
 
+// Tell cpu that thread is spinning in wait loop, so it gives execution resources to other hyperthread
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CPU_PAUSE() __asm__ __volatile__("yield")
+#else 
+#define CPU_PAUSE() 
+#endif 
+
 #if COMPILER_LLVM || COMPILER_GCC
 #define EXPORT __attribute__((visibility("default")))
 #define IMPORT 
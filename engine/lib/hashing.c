@@ -1,16 +1,98 @@
 #include "hashing.h"
 #include "memory.h"
 
-u32 
-hash_string(const char *str) {
-    u32 result = 5381;
-    // djb2 algorithm - suitable for general-purpose string hashing
-    while (*str) {
-        result = ((result << 5) + result) + *str++;
-    }
+#include <stdatomic.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// wyhash final version 4, by Wang Yi (public domain)
+static const u64 WYHASH_SECRET[4] = { 
+    0x2d358dccaa6c78a5llu, 0x8bb84b93962eacc9llu, 0x4b33a62ed433d4a3llu, 0x4d5a2da51de1aa47llu 
+};
+
+static void 
+wyhash_mum(u64 *a, u64 *b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (u64)r;
+    *b = (u64)(r >> 64);
+}
+
+static u64 
+wyhash_mix(u64 a, u64 b) {
+    wyhash_mum(&a, &b);
+    return a ^ b;
+}
+
+static u64 
+wyhash_read8(const u8 *p) {
+    u64 result;
+    mem_copy(&result, p, sizeof(result));
+    return result;
+}
+
+static u64 
+wyhash_read4(const u8 *p) {
+    u32 result;
+    mem_copy(&result, p, sizeof(result));
     return result;
 }
 
+u64 
+hash_bytes(const void *data, uptr size, u64 seed) {
+    const u8 *p = (const u8 *)data;
+    const u64 *secret = WYHASH_SECRET;
+    seed ^= wyhash_mix(seed ^ secret[0], secret[1]);
+    u64 a = 0;
+    u64 b = 0;
+    if (size <= 16) {
+        if (size >= 4) {
+            a = (wyhash_read4(p) << 32) | wyhash_read4(p + ((size >> 3) << 2));
+            b = (wyhash_read4(p + size - 4) << 32) | wyhash_read4(p + size - 4 - ((size >> 3) << 2));
+        } else if (size > 0) {
+            a = ((u64)p[0] << 16) | ((u64)p[size >> 1] << 8) | p[size - 1];
+        }
+    } else {
+        uptr i = size;
+        if (i > 48) {
+            u64 see1 = seed;
+            u64 see2 = seed;
+            do {
+                seed = wyhash_mix(wyhash_read8(p) ^ secret[1], wyhash_read8(p + 8) ^ seed);
+                see1 = wyhash_mix(wyhash_read8(p + 16) ^ secret[2], wyhash_read8(p + 24) ^ see1);
+                see2 = wyhash_mix(wyhash_read8(p + 32) ^ secret[3], wyhash_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wyhash_mix(wyhash_read8(p) ^ secret[1], wyhash_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyhash_read8(p + i - 16);
+        b = wyhash_read8(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    wyhash_mum(&a, &b);
+    return wyhash_mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+u64 
+hash_text(Text text) {
+    return hash_bytes(text.data, text.len, HASH_DEFAULT_SEED);
+}
+
+u64 
+hash_string(const char *str) {
+    return hash_bytes(str, str_len(str), HASH_DEFAULT_SEED);
+}
+
 static const u32 CRC32_LUT[] = {
     0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9,
     0x130476dc, 0x17c56b6b, 0x1a864db2, 0x1e475005,
@@ -78,62 +160,936 @@ static const u32 CRC32_LUT[] = {
     0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
-u32 
-crc32(u32 crc, const void *bf_init, uptr bf_sz) {
-    u8 *bf = (u8 *)bf_init;
+// Slicing-by-8 tables: CRC32_SLICE_LUT[k][b] is the crc contribution of byte b followed by k zero bytes.
+// CRC32_SLICE_LUT[0] is the same as CRC32_LUT. Built lazily on first use.
+static u32 CRC32_SLICE_LUT[8][256];
+static atomic_int crc32_slice_lut_state; // 0 - not built, 1 - building, 2 - ready
+
+static void 
+crc32_init_slice_lut(void) {
+    if (atomic_load_explicit(&crc32_slice_lut_state, memory_order_acquire) == 2) {
+        return;
+    }
+    
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&crc32_slice_lut_state, &expected, 1)) {
+        for (u32 b = 0; b < 256; ++b) {
+            CRC32_SLICE_LUT[0][b] = CRC32_LUT[b];
+        }
+        for (u32 k = 1; k < 8; ++k) {
+            for (u32 b = 0; b < 256; ++b) {
+                u32 prev = CRC32_SLICE_LUT[k - 1][b];
+                CRC32_SLICE_LUT[k][b] = (prev << 8) ^ CRC32_LUT[prev >> 24];
+            }
+        }
+        atomic_store_explicit(&crc32_slice_lut_state, 2, memory_order_release);
+    } else {
+        while (atomic_load_explicit(&crc32_slice_lut_state, memory_order_acquire) != 2) {
+        }
+    }
+}
+
+static u32 
+crc32_read_be32(const u8 *p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+static u32 
+crc32_slice8(u32 crc, const u8 *bf, uptr bf_sz) {
+    crc32_init_slice_lut();
+    const u32 (*t)[256] = (const u32 (*)[256])CRC32_SLICE_LUT;
+    while (bf_sz >= 8) {
+        u32 one = crc ^ crc32_read_be32(bf);
+        u32 two = crc32_read_be32(bf + 4);
+        crc = t[7][one >> 24] ^ t[6][(one >> 16) & 0xFF] ^ t[5][(one >> 8) & 0xFF] ^ t[4][one & 0xFF] ^
+              t[3][two >> 24] ^ t[2][(two >> 16) & 0xFF] ^ t[1][(two >> 8) & 0xFF] ^ t[0][two & 0xFF];
+        bf += 8;
+        bf_sz -= 8;
+    }
     while (bf_sz--) {
         crc = (crc << 8) ^ CRC32_LUT[((crc >> 24) ^ *bf++) & 0xFF];
-    }  
+    }
     return crc;
 }
 
-static u64 *
-hash64_get_internal(Hash64 *hash, u64 key) {
-    if (key == 0) {
-        return 0;
+// Carry-less multiplication folding.
+// Data is viewed as a polynomial with the first byte's top bit being the highest coefficient (the crc
+// is not reflected), so 16-byte blocks are loaded byte-reversed to get bit i = coefficient of x^i.
+// 128-bit value X = H*x^64 + L is moved D bits forward as clmul(H, x^(D+64) mod P) ^ clmul(L, x^D mod P).
+// Remaining 128-bit accumulator and the tail are finished with the table path.
+#define CRC32_FOLD_MIN_SIZE 256
+// x^(D+64) mod P, x^D mod P for D = 512, 128
+#define CRC32_K_512_HI 0x8833794cllu
+#define CRC32_K_512_LO 0xe6228b11llu
+#define CRC32_K_128_HI 0xc5b9cd4cllu
+#define CRC32_K_128_LO 0xe8a45605llu
+// D = 384 and 256, used when merging the 4 lanes
+#define CRC32_K_384_HI 0x64bf7a9bllu
+#define CRC32_K_384_LO 0x8c3828a8llu
+#define CRC32_K_256_HI 0x569700e5llu
+#define CRC32_K_256_LO 0x75be46b7llu
+
+static u32 
+crc32_fold_finish(u64 hi, u64 lo, const u8 *tail, uptr tail_sz) {
+    u8 bytes[16];
+    for (u32 i = 0; i < 8; ++i) {
+        bytes[i] = (u8)(hi >> (56 - i * 8));
+        bytes[8 + i] = (u8)(lo >> (56 - i * 8));
     }
+    u32 crc = crc32_slice8(0, bytes, sizeof(bytes));
+    return crc32_slice8(crc, tail, tail_sz);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CRC32_HAS_CLMUL 1
+#include <wmmintrin.h> // _mm_clmulepi64_si128
+#include <tmmintrin.h> // _mm_shuffle_epi8
+
+#define CRC32_CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+
+CRC32_CLMUL_TARGET static __m128i 
+crc32_clmul_load(const u8 *p) {
+    const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), reverse);
+}
+
+CRC32_CLMUL_TARGET static __m128i 
+crc32_clmul_fold(__m128i x, __m128i k) {
+    // k holds x^(D+64) mod P in the high half and x^D mod P in the low half
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00));
+}
+
+CRC32_CLMUL_TARGET static u32 
+crc32_clmul(u32 crc, const u8 *bf, uptr bf_sz) {
+    const __m128i k512 = _mm_set_epi64x(CRC32_K_512_HI, CRC32_K_512_LO);
+    const __m128i k384 = _mm_set_epi64x(CRC32_K_384_HI, CRC32_K_384_LO);
+    const __m128i k256 = _mm_set_epi64x(CRC32_K_256_HI, CRC32_K_256_LO);
+    const __m128i k128 = _mm_set_epi64x(CRC32_K_128_HI, CRC32_K_128_LO);
     
-    u64 *result = 0;
+    __m128i x0 = _mm_xor_si128(crc32_clmul_load(bf), _mm_set_epi32((int)crc, 0, 0, 0));
+    __m128i x1 = crc32_clmul_load(bf + 16);
+    __m128i x2 = crc32_clmul_load(bf + 32);
+    __m128i x3 = crc32_clmul_load(bf + 48);
+    bf += 64;
+    bf_sz -= 64;
+    while (bf_sz >= 64) {
+        x0 = _mm_xor_si128(crc32_clmul_fold(x0, k512), crc32_clmul_load(bf));
+        x1 = _mm_xor_si128(crc32_clmul_fold(x1, k512), crc32_clmul_load(bf + 16));
+        x2 = _mm_xor_si128(crc32_clmul_fold(x2, k512), crc32_clmul_load(bf + 32));
+        x3 = _mm_xor_si128(crc32_clmul_fold(x3, k512), crc32_clmul_load(bf + 48));
+        bf += 64;
+        bf_sz -= 64;
+    }
+    
+    __m128i x = _mm_xor_si128(_mm_xor_si128(crc32_clmul_fold(x0, k384), crc32_clmul_fold(x1, k256)),
+                              _mm_xor_si128(crc32_clmul_fold(x2, k128), x3));
+    while (bf_sz >= 16) {
+        x = _mm_xor_si128(crc32_clmul_fold(x, k128), crc32_clmul_load(bf));
+        bf += 16;
+        bf_sz -= 16;
+    }
+    
+    u64 halves[2];
+    _mm_storeu_si128((__m128i *)halves, x);
+    return crc32_fold_finish(halves[1], halves[0], bf, bf_sz);
+}
+
+static bool 
+crc32_has_clmul(void) {
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define CRC32_HAS_CLMUL 1
+
+static uint64x2_t 
+crc32_clmul_load(const u8 *p) {
+    uint8x16_t v = vrev64q_u8(vld1q_u8(p));
+    return vreinterpretq_u64_u8(vextq_u8(v, v, 8));
+}
+
+static uint64x2_t 
+crc32_clmul_fold(uint64x2_t x, u64 k_hi, u64 k_lo) {
+    poly128_t hi = vmull_p64((poly64_t)vgetq_lane_u64(x, 1), (poly64_t)k_hi);
+    poly128_t lo = vmull_p64((poly64_t)vgetq_lane_u64(x, 0), (poly64_t)k_lo);
+    return veorq_u64(vreinterpretq_u64_p128(hi), vreinterpretq_u64_p128(lo));
+}
+
+static u32 
+crc32_clmul(u32 crc, const u8 *bf, uptr bf_sz) {
+    uint64x2_t x0 = crc32_clmul_load(bf);
+    x0 = vsetq_lane_u64(vgetq_lane_u64(x0, 1) ^ ((u64)crc << 32), x0, 1);
+    uint64x2_t x1 = crc32_clmul_load(bf + 16);
+    uint64x2_t x2 = crc32_clmul_load(bf + 32);
+    uint64x2_t x3 = crc32_clmul_load(bf + 48);
+    bf += 64;
+    bf_sz -= 64;
+    while (bf_sz >= 64) {
+        x0 = veorq_u64(crc32_clmul_fold(x0, CRC32_K_512_HI, CRC32_K_512_LO), crc32_clmul_load(bf));
+        x1 = veorq_u64(crc32_clmul_fold(x1, CRC32_K_512_HI, CRC32_K_512_LO), crc32_clmul_load(bf + 16));
+        x2 = veorq_u64(crc32_clmul_fold(x2, CRC32_K_512_HI, CRC32_K_512_LO), crc32_clmul_load(bf + 32));
+        x3 = veorq_u64(crc32_clmul_fold(x3, CRC32_K_512_HI, CRC32_K_512_LO), crc32_clmul_load(bf + 48));
+        bf += 64;
+        bf_sz -= 64;
+    }
+    
+    uint64x2_t x = veorq_u64(veorq_u64(crc32_clmul_fold(x0, CRC32_K_384_HI, CRC32_K_384_LO), 
+                                       crc32_clmul_fold(x1, CRC32_K_256_HI, CRC32_K_256_LO)),
+                             veorq_u64(crc32_clmul_fold(x2, CRC32_K_128_HI, CRC32_K_128_LO), x3));
+    while (bf_sz >= 16) {
+        x = veorq_u64(crc32_clmul_fold(x, CRC32_K_128_HI, CRC32_K_128_LO), crc32_clmul_load(bf));
+        bf += 16;
+        bf_sz -= 16;
+    }
+    
+    return crc32_fold_finish(vgetq_lane_u64(x, 1), vgetq_lane_u64(x, 0), bf, bf_sz);
+}
+
+static bool 
+crc32_has_clmul(void) {
+    // Selected at compile time from target features
+    return true;
+}
+
+#else 
+#define CRC32_HAS_CLMUL 0
+#endif 
+
+u32 
+crc32(u32 crc, const void *bf_init, uptr bf_sz) {
+    const u8 *bf = (const u8 *)bf_init;
+#if CRC32_HAS_CLMUL
+    if (bf_sz >= CRC32_FOLD_MIN_SIZE && crc32_has_clmul()) {
+        return crc32_clmul(crc, bf, bf_sz);
+    }
+#endif 
+    return crc32_slice8(crc, bf, bf_sz);
+}
+
+u32 
+crc32_portable(u32 crc, const void *bf, uptr bf_sz) {
+    return crc32_slice8(crc, (const u8 *)bf, bf_sz);
+}
+
+// a * b mod P in GF(2)
+static u32 
+crc32_mulmod(u32 a, u32 b) {
+    u32 result = 0;
+    for (u32 i = 0; i < 32; ++i) {
+        result = (result << 1) ^ ((result & 0x80000000) ? 0x04C11DB7 : 0);
+        if (b & (0x80000000u >> i)) {
+            result ^= a;
+        }
+    }
+    return result;
+}
+
+u32 
+crc32_combine(u32 crc_a, u32 crc_b, uptr b_sz) {
+    // crc(A || B) = crc(A) * x^(8 * |B|) + crc_0(B), square-and-multiply for x^(8 * |B|) mod P
+    u32 shift = 1;
+    u32 base = 0x100; // x^8
+    while (b_sz) {
+        if (b_sz & 1) {
+            shift = crc32_mulmod(shift, base);
+        }
+        base = crc32_mulmod(base, base);
+        b_sz >>= 1;
+    }
+    return crc32_mulmod(crc_a, shift) ^ crc_b;
+}
+
+u64 
+hash64_mix(u64 key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9llu;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBllu;
+    key ^= key >> 31;
+    return key;
+}
+
+// Returns index of slot containing key, or of empty slot where key should be inserted
+static u32 
+hash64_find_slot(Hash64 *hash, u64 key) {
     assert(IS_POW2(hash->num_buckets));
-    u64 hash_value = key;
     u64 hash_mask = hash->num_buckets - 1;
-    for (u64 offset = 0; offset < hash->num_buckets; ++offset) {
-        u64 hash_idx = (hash_value + offset) & hash_mask;
+    u64 hash_idx = hash64_mix(key) & hash_mask;
+    for (;;) {
         u64 test_key = hash->keys[hash_idx];
         if (test_key == key || test_key == 0) {
-            result = &hash->values[hash_idx];
             break;
         }
+        hash_idx = (hash_idx + 1) & hash_mask;
     }
-    return result;
+    return (u32)hash_idx;
 }
 
-Hash64 
-create_hash64(u32 n) {
-    Hash64 hash = {};
+static Hash64 
+create_hash64_internal(u32 n) {
+    Hash64 hash = {0};
     hash.num_buckets = n;
-    hash.keys = mem_alloc_arr(n, u64);
-    hash.values = mem_alloc_arr(n, u64);
+    hash.keys = mem_alloc_tagged(n * sizeof(u64), MEMORY_TAG_HASH | MEMORY_FLAG_HUGE_PAGES);
+    hash.values = mem_alloc_tagged(n * sizeof(u64), MEMORY_TAG_HASH | MEMORY_FLAG_HUGE_PAGES);
     return hash;
 }
 
+static void 
+hash64_resize(Hash64 *hash, u32 new_num_buckets) {
+    Hash64 new_hash = create_hash64_internal(new_num_buckets);
+    for (u32 i = 0; i < hash->num_buckets; ++i) {
+        u64 key = hash->keys[i];
+        if (key) {
+            u32 idx = hash64_find_slot(&new_hash, key);
+            new_hash.keys[idx] = key;
+            new_hash.values[idx] = hash->values[i];
+        }
+    }
+    new_hash.count = hash->count;
+    destroy_hash64(hash);
+    *hash = new_hash;
+}
+
+Hash64 
+create_hash64(u32 n) {
+    if (n < 8) {
+        n = 8;
+    }
+    return create_hash64_internal(align_to_next_pow2(n));
+}
+
+void 
+destroy_hash64(Hash64 *hash) {
+    if (hash->keys) {
+        mem_free(hash->keys, hash->num_buckets * sizeof(u64));
+        mem_free(hash->values, hash->num_buckets * sizeof(u64));
+    }
+    mem_zero(hash, sizeof(*hash));
+}
+
 bool 
 hash64_set(Hash64 *hash, u64 key, u64 value) {
     bool result = false;
-    u64 *value_ptr = hash64_get_internal(hash, key);
-    if (value_ptr) {
-        *value_ptr = value;
+    if (key) {
+        u32 idx = 0;
+        bool is_present = false;
+        if (hash->num_buckets) {
+            idx = hash64_find_slot(hash, key);
+            is_present = hash->keys[idx] != 0;
+        }
+        // Overwriting existing key doesn't change load, so table only grows on insertion
+        if (!is_present) {
+            if ((u64)(hash->count + 1) * HASH64_MAX_LOAD_FACTOR_DEN >
+                (u64)hash->num_buckets * HASH64_MAX_LOAD_FACTOR_NUM) {
+                hash64_resize(hash, hash->num_buckets ? hash->num_buckets * 2 : 8);
+                idx = hash64_find_slot(hash, key);
+            }
+            hash->keys[idx] = key;
+            ++hash->count;
+        }
+        hash->values[idx] = value;
         result = true;
     }
     return result;
 }
 
+u64 *
+hash64_get_ptr(Hash64 *hash, u64 key) {
+    u64 *result = 0;
+    if (key && hash->num_buckets) {
+        u32 idx = hash64_find_slot(hash, key);
+        if (hash->keys[idx]) {
+            result = hash->values + idx;
+        }
+    }
+    return result;
+}
+
 u64 
 hash64_get(Hash64 *hash, u64 key, u64 default_value) {
     u64 result = default_value;
-    u64 *value_ptr = hash64_get_internal(hash, key);
-    if (value_ptr && *value_ptr) {
+    u64 *value_ptr = hash64_get_ptr(hash, key);
+    if (value_ptr) {
+        result = *value_ptr;
+    }
+    return result;
+}
+
+bool 
+hash64_delete(Hash64 *hash, u64 key) {
+    bool result = false;
+    if (key && hash->num_buckets) {
+        u32 hole = hash64_find_slot(hash, key);
+        if (hash->keys[hole]) {
+            result = true;
+            u32 mask = hash->num_buckets - 1;
+            u32 idx = (hole + 1) & mask;
+            while (hash->keys[idx]) {
+                u32 home = hash64_mix(hash->keys[idx]) & mask;
+                // Item can be moved to the hole if hole lies between its home slot and its position
+                if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+                    hash->keys[hole] = hash->keys[idx];
+                    hash->values[hole] = hash->values[idx];
+                    hole = idx;
+                }
+                idx = (idx + 1) & mask;
+            }
+            hash->keys[hole] = 0;
+            hash->values[hole] = 0;
+            --hash->count;
+        }
+    }
+    return result;
+}
+
+// Control byte values. Occupied slots have top bit clear
+#define HASH64_CTRL_EMPTY   0x80
+#define HASH64_CTRL_DELETED 0xFE
+CT_ASSERT(HASH64_GROUP_SIZE == 16);
+
+// Returns bitmask where bit i is set if ctrl[i] == value
+static u32 
+group_match(const u8 *ctrl, u8 value) {
+    u32 result = 0;
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    result = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#elif defined(__ARM_NEON)
+    static const u8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(value));
+    uint8x16_t masked = vandq_u8(eq, vld1q_u8(bits));
+    result = (u32)vaddv_u8(vget_low_u8(masked)) | ((u32)vaddv_u8(vget_high_u8(masked)) << 8);
+#else 
+    for (u32 i = 0; i < HASH64_GROUP_SIZE; ++i) {
+        result |= (u32)(ctrl[i] == value) << i;
+    }
+#endif 
+    return result;
+}
+
+static u8 
+group_hash64_h2(u64 hash) {
+    return (u8)(hash & 0x7F);
+}
+
+static u32 
+group_hash64_h1(u64 hash) {
+    return (u32)(hash >> 7);
+}
+
+static Group_Hash64
+create_group_hash64_internal(u32 num_groups) {
+    Group_Hash64 hash = {0};
+    hash.num_groups = num_groups;
+    hash.groups = mem_alloc_uninit_tagged(num_groups * sizeof(Hash64_Group), 
+        MEMORY_TAG_HASH | MEMORY_FLAG_HUGE_PAGES);
+    for (u32 i = 0; i < num_groups; ++i) {
+        for (u32 j = 0; j < HASH64_GROUP_SIZE; ++j) {
+            hash.groups[i].ctrl[j] = HASH64_CTRL_EMPTY;
+        }
+    }
+    return hash;
+}
+
+// Find slot to insert key that is known not to be in table.
+// Probing goes through groups in triangular sequence, which visits all groups for power of two count
+static Hash64_Entry *
+group_hash64_find_insert_slot(Group_Hash64 *hash, u64 key_hash, u8 **ctrl_out) {
+    u32 mask = hash->num_groups - 1;
+    u32 group_idx = group_hash64_h1(key_hash) & mask;
+    for (u32 step = 1;; ++step) {
+        Hash64_Group *group = hash->groups + group_idx;
+        u32 free_mask = group_match(group->ctrl, HASH64_CTRL_EMPTY) | 
+            group_match(group->ctrl, HASH64_CTRL_DELETED);
+        if (free_mask) {
+            u32 slot = __builtin_ctz(free_mask);
+            *ctrl_out = group->ctrl + slot;
+            return group->entries + slot;
+        }
+        group_idx = (group_idx + step) & mask;
+    }
+}
+
+static void 
+group_hash64_resize(Group_Hash64 *hash, u32 new_num_groups) {
+    Group_Hash64 new_hash = create_group_hash64_internal(new_num_groups);
+    for (u32 i = 0; i < hash->num_groups; ++i) {
+        Hash64_Group *group = hash->groups + i;
+        for (u32 j = 0; j < HASH64_GROUP_SIZE; ++j) {
+            if (!(group->ctrl[j] & 0x80)) {
+                u64 key_hash = hash64_mix(group->entries[j].key);
+                u8 *ctrl = 0;
+                Hash64_Entry *entry = group_hash64_find_insert_slot(&new_hash, key_hash, &ctrl);
+                *ctrl = group_hash64_h2(key_hash);
+                *entry = group->entries[j];
+            }
+        }
+    }
+    new_hash.count = hash->count;
+    destroy_group_hash64(hash);
+    *hash = new_hash;
+}
+
+Group_Hash64 
+create_group_hash64(u32 n) {
+    // Keep load factor under 7/8
+    u32 num_groups = align_to_next_pow2((n * 8 / 7 + HASH64_GROUP_SIZE - 1) / HASH64_GROUP_SIZE);
+    if (num_groups < 1) {
+        num_groups = 1;
+    }
+    return create_group_hash64_internal(num_groups);
+}
+
+void 
+destroy_group_hash64(Group_Hash64 *hash) {
+    if (hash->groups) {
+        mem_free(hash->groups, hash->num_groups * sizeof(Hash64_Group));
+    }
+    mem_zero(hash, sizeof(*hash));
+}
+
+u64 *
+group_hash64_get_ptr(Group_Hash64 *hash, u64 key) {
+    u64 *result = 0;
+    if (hash->num_groups) {
+        u64 key_hash = hash64_mix(key);
+        u8 h2 = group_hash64_h2(key_hash);
+        u32 mask = hash->num_groups - 1;
+        u32 group_idx = group_hash64_h1(key_hash) & mask;
+        for (u32 step = 1; step <= hash->num_groups; ++step) {
+            Hash64_Group *group = hash->groups + group_idx;
+            u32 match_mask = group_match(group->ctrl, h2);
+            while (match_mask) {
+                u32 slot = __builtin_ctz(match_mask);
+                if (group->entries[slot].key == key) {
+                    return &group->entries[slot].value;
+                }
+                match_mask &= match_mask - 1;
+            }
+            // Probe sequence ends at first group that has empty slots
+            if (group_match(group->ctrl, HASH64_CTRL_EMPTY)) {
+                break;
+            }
+            group_idx = (group_idx + step) & mask;
+        }
+    }
+    return result;
+}
+
+u64 
+group_hash64_get(Group_Hash64 *hash, u64 key, u64 default_value) {
+    u64 result = default_value;
+    u64 *value_ptr = group_hash64_get_ptr(hash, key);
+    if (value_ptr) {
         result = *value_ptr;
     }
     return result;
 }
+
+void 
+group_hash64_set(Group_Hash64 *hash, u64 key, u64 value) {
+    u64 *value_ptr = group_hash64_get_ptr(hash, key);
+    if (value_ptr) {
+        *value_ptr = value;
+    } else {
+        u64 capacity = (u64)hash->num_groups * HASH64_GROUP_SIZE;
+        if ((u64)(hash->count + hash->deleted_count + 1) * 8 > capacity * 7) {
+            // If most of used slots are deleted, rehash into same size to clean them up
+            u32 new_num_groups = hash->num_groups ? hash->num_groups : 1;
+            if ((u64)(hash->count + 1) * 16 > capacity * 7) {
+                new_num_groups *= 2;
+            }
+            group_hash64_resize(hash, new_num_groups);
+        }
+        
+        u64 key_hash = hash64_mix(key);
+        u8 *ctrl = 0;
+        Hash64_Entry *entry = group_hash64_find_insert_slot(hash, key_hash, &ctrl);
+        if (*ctrl == HASH64_CTRL_DELETED) {
+            --hash->deleted_count;
+        }
+        *ctrl = group_hash64_h2(key_hash);
+        entry->key = key;
+        entry->value = value;
+        ++hash->count;
+    }
+}
+
+bool 
+group_hash64_delete(Group_Hash64 *hash, u64 key) {
+    bool result = false;
+    u64 *value_ptr = group_hash64_get_ptr(hash, key);
+    if (value_ptr) {
+        Hash64_Entry *entry = (Hash64_Entry *)((u8 *)value_ptr - STRUCT_OFFSET(Hash64_Entry, value));
+        uptr group_idx = ((u8 *)entry - (u8 *)hash->groups) / sizeof(Hash64_Group);
+        Hash64_Group *group = hash->groups + group_idx;
+        uptr slot = entry - group->entries;
+        // If group has empty slot, it has never been full, so no probe sequence went past it 
+        // and slot can be marked empty. Otherwise tombstone has to be left
+        if (group_match(group->ctrl, HASH64_CTRL_EMPTY)) {
+            group->ctrl[slot] = HASH64_CTRL_EMPTY;
+        } else {
+            group->ctrl[slot] = HASH64_CTRL_DELETED;
+            ++hash->deleted_count;
+        }
+        --hash->count;
+        result = true;
+    }
+    return result;
+}
+
+// Slot key states
+#define CHASH64_KEY_EMPTY 0
+// Empty slot that was sealed during migration, so no key can be inserted in it
+#define CHASH64_KEY_SEALED ((u64)-1)
+// Values are stored biased, so zeroed memory means slot with no value yet written
+#define CHASH64_VALUE_NONE 0
+#define CHASH64_VALUE_TOMBSTONE 1
+#define CHASH64_VALUE_BIAS 2
+// Set on value of old table slot once it is copied to new table. Slot can't be written to after that
+#define CHASH64_VALUE_FROZEN (1llu << 63)
+// Special results of chash64_find
+#define CHASH64_MISSING ((u32)-1)
+#define CHASH64_CHAIN_SEALED ((u32)-2)
+#define CHASH64_FULL ((u32)-3)
+
+typedef struct {
+    _Atomic(u64) key;
+    _Atomic(u64) value;
+} Concurrent_Hash64_Entry;
+
+struct Concurrent_Hash64_Table {
+    u32 num_buckets;
+    // Number of keys placed in table, including deleted ones. Used to trigger resize
+    _Atomic(u32) claimed_count;
+    // Next chunk to be migrated
+    _Atomic(u32) migrate_cursor;
+    _Atomic(u32) migrated_count;
+    _Atomic(Concurrent_Hash64_Table *) next;
+    Concurrent_Hash64_Table *retired_next;
+    Concurrent_Hash64_Entry entries[];
+};
+
+typedef enum {
+    CHASH64_WRITE_SET,
+    CHASH64_WRITE_SET_IF_ABSENT,
+    CHASH64_WRITE_DELETE,
+    // Copy of value from older table - only done if no value was written to slot yet
+    CHASH64_WRITE_COPY,
+} CHash64_Write_Mode;
+
+static u64 chash64_write(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table, 
+                         u64 key, u64 value, CHash64_Write_Mode mode);
+
+static Concurrent_Hash64_Table *
+chash64_alloc_table(u32 num_buckets) {
+    Concurrent_Hash64_Table *table = mem_alloc_tagged(sizeof(Concurrent_Hash64_Table) + 
+        num_buckets * sizeof(Concurrent_Hash64_Entry), MEMORY_TAG_HASH | MEMORY_FLAG_HUGE_PAGES);
+    table->num_buckets = num_buckets;
+    return table;
+}
+
+static void 
+chash64_free_table(Concurrent_Hash64_Table *table) {
+    mem_free(table, sizeof(Concurrent_Hash64_Table) + table->num_buckets * sizeof(Concurrent_Hash64_Entry));
+}
+
+static void 
+chash64_start_resize(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table) {
+    if (!atomic_load(&table->next)) {
+        // Size new table by number of live items, so tables filled with tombstones don't grow
+        i64 live = atomic_load(&hash->count);
+        u64 num_buckets = 8;
+        while (num_buckets * CONCURRENT_HASH64_MAX_LOAD_FACTOR_NUM < 
+               (u64)(live < 0 ? 0 : live) * 2 * CONCURRENT_HASH64_MAX_LOAD_FACTOR_DEN) {
+            num_buckets *= 2;
+        }
+        assert(num_buckets <= (1llu << 31));
+        
+        Concurrent_Hash64_Table *new_table = chash64_alloc_table((u32)num_buckets);
+        Concurrent_Hash64_Table *expected = 0;
+        if (!atomic_compare_exchange_strong(&table->next, &expected, new_table)) {
+            chash64_free_table(new_table);
+        }
+    }
+}
+
+// Returns index of slot with key. If key is not present and claim is set, key is placed in first empty slot.
+// Otherwise one of special results is returned
+static u32 
+chash64_find(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table, u64 key, bool claim) {
+    u32 result = CHASH64_FULL;
+    u32 mask = table->num_buckets - 1;
+    u32 idx = hash64_mix(key) & mask;
+    for (u32 probe = 0; probe < table->num_buckets; ++probe) {
+        Concurrent_Hash64_Entry *entry = table->entries + idx;
+        u64 slot_key = atomic_load(&entry->key);
+        if (slot_key == CHASH64_KEY_EMPTY) {
+            if (!claim) {
+                result = CHASH64_MISSING;
+                break;
+            }
+            
+            if (atomic_compare_exchange_strong(&entry->key, &slot_key, key)) {
+                u32 claimed = atomic_fetch_add(&table->claimed_count, 1) + 1;
+                if ((u64)claimed * CONCURRENT_HASH64_MAX_LOAD_FACTOR_DEN > 
+                    (u64)table->num_buckets * CONCURRENT_HASH64_MAX_LOAD_FACTOR_NUM) {
+                    chash64_start_resize(hash, table);
+                }
+                result = idx;
+                break;
+            }
+            // slot_key now holds key that won the race
+        }
+        
+        if (slot_key == key) {
+            result = idx;
+            break;
+        } else if (slot_key == CHASH64_KEY_SEALED) {
+            result = CHASH64_CHAIN_SEALED;
+            break;
+        }
+        idx = (idx + 1) & mask;
+    }
+    return result;
+}
+
+// Freezes value of slot and copies it to next table
+static void 
+chash64_copy_slot(Concurrent_Hash64 *hash, Concurrent_Hash64_Entry *entry, Concurrent_Hash64_Table *next) {
+    u64 value = atomic_load(&entry->value);
+    while (!(value & CHASH64_VALUE_FROZEN) && 
+           !atomic_compare_exchange_weak(&entry->value, &value, value | CHASH64_VALUE_FROZEN)) {
+    }
+    value &= ~CHASH64_VALUE_FROZEN;
+    // All threads copying slot copy same frozen value, so it does not matter which one wins
+    if (value >= CHASH64_VALUE_BIAS) {
+        chash64_write(hash, next, atomic_load(&entry->key), value, CHASH64_WRITE_COPY);
+    }
+}
+
+// Makes sure that slot at idx can no longer be written to, and its value is in next table
+static void 
+chash64_migrate_slot(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table, u32 idx, 
+                     Concurrent_Hash64_Table *next) {
+    Concurrent_Hash64_Entry *entry = table->entries + idx;
+    u64 key = CHASH64_KEY_EMPTY;
+    if (!atomic_compare_exchange_strong(&entry->key, &key, CHASH64_KEY_SEALED) && 
+        key != CHASH64_KEY_SEALED) {
+        chash64_copy_slot(hash, entry, next);
+    }
+}
+
+// Migrates key from table to next one before it can be written in next table. 
+// Empty slot at the end of probe chain is sealed, so key can't be inserted in old table after that
+static void 
+chash64_migrate_key(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table, u64 key, 
+                    Concurrent_Hash64_Table *next) {
+    u32 mask = table->num_buckets - 1;
+    u32 idx = hash64_mix(key) & mask;
+    for (u32 probe = 0; probe < table->num_buckets; ++probe) {
+        Concurrent_Hash64_Entry *entry = table->entries + idx;
+        u64 slot_key = CHASH64_KEY_EMPTY;
+        if (atomic_compare_exchange_strong(&entry->key, &slot_key, CHASH64_KEY_SEALED) || 
+            slot_key == CHASH64_KEY_SEALED) {
+            break;
+        } else if (slot_key == key) {
+            chash64_copy_slot(hash, entry, next);
+            break;
+        }
+        idx = (idx + 1) & mask;
+    }
+}
+
+// Moves root past tables that are fully migrated
+static void 
+chash64_advance_root(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table) {
+    while (atomic_load(&table->migrated_count) == table->num_buckets) {
+        Concurrent_Hash64_Table *next = atomic_load(&table->next);
+        Concurrent_Hash64_Table *expected = table;
+        // Fails if older table is still being migrated - thread that finishes it advances root further
+        if (!atomic_compare_exchange_strong(&hash->root, &expected, next)) {
+            break;
+        }
+        
+        Concurrent_Hash64_Table *retired = atomic_load(&hash->retired);
+        do {
+            table->retired_next = retired;
+        } while (!atomic_compare_exchange_weak(&hash->retired, &retired, table));
+        table = next;
+    }
+}
+
+static void 
+chash64_help_migrate(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table, Concurrent_Hash64_Table *next) {
+    u32 start = atomic_load(&table->migrate_cursor);
+    if (start < table->num_buckets) {
+        start = atomic_fetch_add(&table->migrate_cursor, CONCURRENT_HASH64_MIGRATE_CHUNK);
+        if (start < table->num_buckets) {
+            u32 end = start + CONCURRENT_HASH64_MIGRATE_CHUNK;
+            if (end > table->num_buckets) {
+                end = table->num_buckets;
+            }
+            for (u32 idx = start; idx < end; ++idx) {
+                chash64_migrate_slot(hash, table, idx, next);
+            }
+            
+            u32 migrated = atomic_fetch_add(&table->migrated_count, end - start) + (end - start);
+            if (migrated == table->num_buckets) {
+                chash64_advance_root(hash, table);
+            }
+        }
+    }
+}
+
+// Returns previous stored value of key
+static u64 
+chash64_write(Concurrent_Hash64 *hash, Concurrent_Hash64_Table *table, u64 key, u64 value, 
+              CHash64_Write_Mode mode) {
+    for (;;) {
+        // Writes go to newest table. Key is migrated from each table on the way there
+        Concurrent_Hash64_Table *next = atomic_load(&table->next);
+        if (next) {
+            if (mode == CHASH64_WRITE_COPY) {
+                // If slot already has value, copy has landed here and newer writes may have followed it, 
+                // which can be deleted and dropped in further migrations - so copy must not go any further
+                u32 idx = chash64_find(hash, table, key, false);
+                if (idx < CHASH64_FULL) {
+                    u64 prev = atomic_load(&table->entries[idx].value) & ~CHASH64_VALUE_FROZEN;
+                    if (prev != CHASH64_VALUE_NONE) {
+                        return prev;
+                    }
+                }
+            } else {
+                chash64_help_migrate(hash, table, next);
+            }
+            chash64_migrate_key(hash, table, key, next);
+            table = next;
+            continue;
+        }
+        
+        u32 idx = chash64_find(hash, table, key, mode != CHASH64_WRITE_DELETE);
+        if (idx == CHASH64_MISSING) {
+            return CHASH64_VALUE_NONE;
+        } else if (idx == CHASH64_FULL) {
+            chash64_start_resize(hash, table);
+            continue;
+        } else if (idx == CHASH64_CHAIN_SEALED) {
+            continue;
+        }
+        
+        Concurrent_Hash64_Entry *entry = table->entries + idx;
+        u64 prev = atomic_load(&entry->value);
+        for (;;) {
+            if (prev & CHASH64_VALUE_FROZEN) {
+                // Table got resized, retry in next one
+                break;
+            } else if ((mode == CHASH64_WRITE_COPY && prev != CHASH64_VALUE_NONE) ||
+                       (mode == CHASH64_WRITE_SET_IF_ABSENT && prev >= CHASH64_VALUE_BIAS) ||
+                       (mode == CHASH64_WRITE_DELETE && prev < CHASH64_VALUE_BIAS)) {
+                return prev;
+            }
+            
+            if (atomic_compare_exchange_weak(&entry->value, &prev, value)) {
+                // Copies move existing items, so they don't change count
+                if (mode != CHASH64_WRITE_COPY) {
+                    i64 delta = (i64)(value >= CHASH64_VALUE_BIAS) - (i64)(prev >= CHASH64_VALUE_BIAS);
+                    if (delta) {
+                        atomic_fetch_add(&hash->count, delta);
+                    }
+                }
+                return prev;
+            }
+        }
+    }
+}
+
+// Returns stored value of key, looking into newer tables if needed
+static u64 
+chash64_read(Concurrent_Hash64_Table *table, u64 key) {
+    for (;;) {
+        u32 idx = chash64_find(0, table, key, false);
+        if (idx == CHASH64_MISSING || idx == CHASH64_CHAIN_SEALED || idx == CHASH64_FULL) {
+            // Key may have been inserted into newer table
+            table = atomic_load(&table->next);
+            if (!table) {
+                return CHASH64_VALUE_NONE;
+            }
+            continue;
+        }
+        
+        u64 value = atomic_load(&table->entries[idx].value);
+        if (value & CHASH64_VALUE_FROZEN) {
+            // Value in newer table is more recent. If it is not yet there, frozen value is still current
+            u64 newer = chash64_read(atomic_load(&table->next), key);
+            if (newer != CHASH64_VALUE_NONE) {
+                value = newer;
+            } else {
+                value &= ~CHASH64_VALUE_FROZEN;
+            }
+        }
+        return value;
+    }
+}
+
+void 
+init_concurrent_hash64(Concurrent_Hash64 *hash, u32 n) {
+    u64 num_buckets = 8;
+    while (num_buckets * CONCURRENT_HASH64_MAX_LOAD_FACTOR_NUM < (u64)n * CONCURRENT_HASH64_MAX_LOAD_FACTOR_DEN) {
+        num_buckets *= 2;
+    }
+    atomic_init(&hash->root, chash64_alloc_table((u32)num_buckets));
+    atomic_init(&hash->retired, 0);
+    atomic_init(&hash->count, 0);
+}
+
+void 
+destroy_concurrent_hash64(Concurrent_Hash64 *hash) {
+    Concurrent_Hash64_Table *table = atomic_load(&hash->root);
+    while (table) {
+        Concurrent_Hash64_Table *next = atomic_load(&table->next);
+        chash64_free_table(table);
+        table = next;
+    }
+    table = atomic_load(&hash->retired);
+    while (table) {
+        Concurrent_Hash64_Table *next = table->retired_next;
+        chash64_free_table(table);
+        table = next;
+    }
+    mem_zero(hash, sizeof(*hash));
+}
+
+void 
+concurrent_hash64_set(Concurrent_Hash64 *hash, u64 key, u64 value) {
+    assert(key != CHASH64_KEY_EMPTY && key != CHASH64_KEY_SEALED);
+    assert(value <= CONCURRENT_HASH64_MAX_VALUE);
+    chash64_write(hash, atomic_load(&hash->root), key, value + CHASH64_VALUE_BIAS, CHASH64_WRITE_SET);
+}
+
+u64 
+concurrent_hash64_get_or_insert(Concurrent_Hash64 *hash, u64 key, u64 value) {
+    assert(key != CHASH64_KEY_EMPTY && key != CHASH64_KEY_SEALED);
+    assert(value <= CONCURRENT_HASH64_MAX_VALUE);
+    u64 prev = chash64_write(hash, atomic_load(&hash->root), key, value + CHASH64_VALUE_BIAS, 
+                             CHASH64_WRITE_SET_IF_ABSENT);
+    return prev >= CHASH64_VALUE_BIAS ? prev - CHASH64_VALUE_BIAS : value;
+}
+
+u64 
+concurrent_hash64_get(Concurrent_Hash64 *hash, u64 key, u64 default_value) {
+    u64 value = chash64_read(atomic_load(&hash->root), key);
+    return value >= CHASH64_VALUE_BIAS ? value - CHASH64_VALUE_BIAS : default_value;
+}
+
+bool 
+concurrent_hash64_delete(Concurrent_Hash64 *hash, u64 key) {
+    u64 prev = chash64_write(hash, atomic_load(&hash->root), key, CHASH64_VALUE_TOMBSTONE, CHASH64_WRITE_DELETE);
+    return prev >= CHASH64_VALUE_BIAS;
+}
+
+u32 
+concurrent_hash64_count(Concurrent_Hash64 *hash) {
+    i64 count = atomic_load(&hash->count);
+    return count > 0 ? (u32)count : 0;
+}
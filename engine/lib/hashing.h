@@ -6,9 +6,24 @@
 // Provides different APIs that are conncected with hashing.
 #pragma once
 #include "lib/general.h"
+#include "strings.h"
 
-u32 hash_string(const char *str);
+// General-purpose 64-bit hash (wyhash algorithm).
+// Reads input 8 bytes at a time and mixes it with 128-bit multiplication, so it is both fast 
+// and has good enough quality for values to be used as identities of strings 
+// Not suitable for cryptographic purposes
+#define HASH_DEFAULT_SEED 0
+u64 hash_bytes(const void *data, uptr size, u64 seed);
+u64 hash_text(Text text);
+u64 hash_string(const char *str);
+// Non-reflected crc32 (poly 0x04C11DB7). Large buffers are folded with carry-less multiplication when
+// the cpu supports it, otherwise slicing-by-8 is used. Results are identical on all paths.
 u32 crc32(u32 crc, const void *bf, uptr bf_sz);
+// Same as crc32, but always uses slicing-by-8. Serves as reference for accelerated path
+u32 crc32_portable(u32 crc, const void *bf, uptr bf_sz);
+// Crc of concatenation A || B given crc of A and crc of B computed with initial value 0.
+// Allows computing crc of chunks independently.
+u32 crc32_combine(u32 crc_a, u32 crc_b, uptr b_sz);
 
 // Type-agnostic implementatin of hash tables.
 // Values are typycally indices of array that actually stores values in it.
@@ -20,23 +35,112 @@ u32 crc32(u32 crc, const void *bf, uptr bf_sz);
 // and also avoids macros madness connected with inability to template in c
 // Use cases that worry about memory can provide its own implementation of hash table
 //
-// Internal chaining hash table
+// Open addressing hash table with linear probing.
+// Keys are passed through mixing function, so keys with patterns (like pointers or indices)
+// are spread evenly across buckets.
+// Table grows when load factor exceeds HASH64_MAX_LOAD_FACTOR, so set never fails.
+// Deletion uses backward shift - items after deleted one are moved back to fill the hole, 
+// so no tombstones are needed and lookup speed does not degrade under churn
 // @NOTE It is almost always possible to have arbitrary sized hash tables and having size be power of two
 // has hash lookup speed benefits - so it is a forced strategy in this implementation
 // @NOTE 0 is not valid key - it is reserved to mark empty slots 
+#define HASH64_MAX_LOAD_FACTOR_NUM 7
+#define HASH64_MAX_LOAD_FACTOR_DEN 8
 typedef struct Hash64 {
     u32 num_buckets;
+    u32 count;
     u64 *keys;
     u64 *values;
 } Hash64;
 
+// Mixing function used to get bucket index from key (splitmix64 finalizer)
+u64 hash64_mix(u64 key);
+
+// n is rounded up to power of two
 Hash64 create_hash64(u32 n);
-//  @NOTE creation and deletion is not specified - because different use cases may want to
-// ahve different allocation strategies and we don't have API for that
+void destroy_hash64(Hash64 *hash);
+// Insert or update value for key
 bool hash64_set(Hash64 *hash, u64 key, u64 value);
 u64 hash64_get(Hash64 *hash, u64 key, u64 default_value);
-// @NOTE internal chaining hash table is not suitable for deletion of items because of current implementation
-// of setting. If we decide to add deletions, there should be two versions of set - set new and reset
-// (because if bucket is chained, and item before it but after its hash idx is deleted program decides to
-// create new slot for this item, despite having it already stored)
-// This is complicated to test at this development stage so it is better to just not have deletions
+// Returns pointer to value stored for key, 0 if key is not present. 
+// Pointer is invalidated by any set or delete
+u64 *hash64_get_ptr(Hash64 *hash, u64 key);
+// Returns true if key was present
+bool hash64_delete(Hash64 *hash, u64 key);
+
+// Hash table with SIMD group probing (design of Swiss tables).
+// Buckets are split into groups of HASH64_GROUP_SIZE. Each group stores control byte per slot, 
+// which holds 7 bits of key hash for occupied slots, or marks slot as empty or deleted.
+// Lookup compares control bytes of whole group with single SIMD instruction, and only then 
+// reads keys of matching slots, so most probes touch only control bytes. 
+// Keys and values of group are stored together, so found key and its value share cache line.
+// Unlike Hash64, all keys are valid, including 0.
+// Suitable for hot lookups in large tables, Hash64 is simpler and uses less memory for small ones
+#define HASH64_GROUP_SIZE 16
+
+typedef struct {
+    u64 key;
+    u64 value;
+} Hash64_Entry;
+
+typedef struct {
+    u8 ctrl[HASH64_GROUP_SIZE];
+    Hash64_Entry entries[HASH64_GROUP_SIZE];
+} Hash64_Group;
+
+typedef struct {
+    u32 num_groups;
+    u32 count;
+    u32 deleted_count;
+    Hash64_Group *groups;
+} Group_Hash64;
+
+// n is number of items table should fit without growing
+Group_Hash64 create_group_hash64(u32 n);
+void destroy_group_hash64(Group_Hash64 *hash);
+void group_hash64_set(Group_Hash64 *hash, u64 key, u64 value);
+u64 group_hash64_get(Group_Hash64 *hash, u64 key, u64 default_value);
+// Pointer is invalidated by any set or delete
+u64 *group_hash64_get_ptr(Group_Hash64 *hash, u64 key);
+bool group_hash64_delete(Group_Hash64 *hash, u64 key);
+
+// Concurrent hash table that can be shared between threads without locks.
+// Open addressing with linear probing, keys and values are updated with CAS.
+// Lookups never wait or retry - they do bounded number of probes in each table.
+// Keys are never removed from table - delete leaves tombstone value, which is dropped on next resize.
+// Resize is incremental: when table fills up, new table is linked after it and all threads doing 
+// writes migrate chunk of slots, so no thread has to copy whole table. Before key is written to new table,
+// its slot in old table is frozen and copied, so writes to old table can't be lost.
+// Tables that are fully migrated are not freed until destroy_concurrent_hash64, because other threads 
+// may still read them. Tables grow geometrically, so this at most doubles memory usage.
+// @NOTE Keys 0 and (u64)-1 are reserved. 
+// @NOTE Values must be not greater than CONCURRENT_HASH64_MAX_VALUE - top bit is used to mark frozen slots
+#define CONCURRENT_HASH64_MAX_VALUE ((1llu << 63) - 3)
+#define CONCURRENT_HASH64_MAX_LOAD_FACTOR_NUM 3
+#define CONCURRENT_HASH64_MAX_LOAD_FACTOR_DEN 4
+// Number of slots migrated by writer at a time
+#define CONCURRENT_HASH64_MIGRATE_CHUNK 64
+
+typedef struct Concurrent_Hash64_Table Concurrent_Hash64_Table;
+
+typedef struct {
+    // Oldest table that is not fully migrated. Tables are linked with next pointer
+    _Atomic(Concurrent_Hash64_Table *) root;
+    // Fully migrated tables
+    _Atomic(Concurrent_Hash64_Table *) retired;
+    _Atomic(i64) count;
+} Concurrent_Hash64;
+
+// n is number of items table should fit without growing
+void init_concurrent_hash64(Concurrent_Hash64 *hash, u32 n);
+// Not thread-safe, no other thread can access table at that time
+void destroy_concurrent_hash64(Concurrent_Hash64 *hash);
+// Insert or update value for key
+void concurrent_hash64_set(Concurrent_Hash64 *hash, u64 key, u64 value);
+// Inserts value if key is not present. Returns value stored for key after call,
+// so threads racing to insert same key all get value of the winner
+u64 concurrent_hash64_get_or_insert(Concurrent_Hash64 *hash, u64 key, u64 value);
+u64 concurrent_hash64_get(Concurrent_Hash64 *hash, u64 key, u64 default_value);
+// Returns true if key was present
+bool concurrent_hash64_delete(Concurrent_Hash64 *hash, u64 key);
+u32 concurrent_hash64_count(Concurrent_Hash64 *hash);
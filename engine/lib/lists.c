@@ -7,31 +7,102 @@ da_reserve_(u32 stride, u32 count) {
     void *result = 0;
     if (count) {
         u64 initial_size = sizeof(DArray_Header) + count * stride;
-        DArray_Header *header = mem_alloc(initial_size);
+        DArray_Header *header = mem_alloc_tagged(initial_size, MEMORY_TAG_DARRAY);
         header->capacity = count;
         result = header + 1;
     }
     return result;
 }
+
 void *
-da_grow(void *a, u32 stride) {
+da_reserve_virtual_(u32 stride, u32 count, u32 max_count) {
+    assert(count <= max_count);
+    u64 max_size = sizeof(DArray_Header) + (u64)max_count * stride;
+    u64 initial_size = sizeof(DArray_Header) + (u64)count * stride;
+    DArray_Header *header = mem_reserve_tagged(max_size, initial_size, MEMORY_TAG_DARRAY);
+    header->capacity = count;
+    header->flags = DA_FLAG_VIRTUAL;
+    header->max_capacity = max_count;
+    return header + 1;
+}
+
+void *
+da_reserve_arena_(u32 stride, u32 count, Memory_Arena *arena) {
+    u64 initial_size = sizeof(DArray_Header) + (u64)count * stride;
+    DArray_Header *header = arena_push(arena, initial_size);
+    mem_zero(header, sizeof(*header));
+    header->capacity = count;
+    header->flags = DA_FLAG_ARENA;
+    header->arena = arena;
+    return header + 1;
+}
+
+// Arena array can be grown in place if it ends exactly where the arena's free space begins
+static bool 
+da_arena_try_grow_in_place(DArray_Header *header, u32 stride, u32 new_capacity) {
+    bool result = false;
+    Memory_Block *block = header->arena->current_block;
+    u8 *array_end = (u8 *)(header + 1) + (u64)header->capacity * stride;
+    u64 extra_size = (u64)(new_capacity - header->capacity) * stride;
+    if (block && block->base + block->used == array_end && 
+        block->used + extra_size <= block->size) {
+        block->used += extra_size;
+        result = true;
+    }
+    return result;
+}
+
+void *
+da_grow_to(void *a, u32 stride, u32 min_capacity) {
     void *result = 0;
     if (a) {
         DArray_Header *header = da_header(a);
-        u64 old_size = sizeof(*header) + header->capacity * stride;
-        u64 new_size = sizeof(*header) + header->capacity * stride * 2;
-        header = mem_realloc(header, old_size, new_size);
-        header->capacity *= 2;
+        u32 new_capacity = header->capacity ? header->capacity * 2 : DA_DEFUALT_SIZE;
+        if (new_capacity < min_capacity) {
+            new_capacity = min_capacity;
+        }
+        u64 old_size = sizeof(*header) + (u64)header->capacity * stride;
+        u64 new_size = sizeof(*header) + (u64)new_capacity * stride;
+        if (header->flags & DA_FLAG_VIRTUAL) {
+            if (new_capacity > header->max_capacity) {
+                new_capacity = header->max_capacity;
+            }
+            // Array has outgrown its reservation and can't move, so there is no way to continue
+            assert_always(new_capacity >= min_capacity);
+            bool is_committed = mem_commit(header, sizeof(*header) + (u64)new_capacity * stride);
+            assert_always(is_committed);
+        } else if (header->flags & DA_FLAG_ARENA) {
+            if (!da_arena_try_grow_in_place(header, stride, new_capacity)) {
+                // Old memory stays in arena until it is reset
+                DArray_Header *new_header = arena_push(header->arena, new_size);
+                mem_copy(new_header, header, old_size);
+                header = new_header;
+            }
+        } else {
+            header = mem_realloc_tagged(header, old_size, new_size, MEMORY_TAG_DARRAY);
+        }
+        header->capacity = new_capacity;
         result = header + 1;
     } else {
-        result = da_reserve_(stride, DA_DEFUALT_SIZE);
+        result = da_reserve_(stride, min_capacity > DA_DEFUALT_SIZE ? min_capacity : DA_DEFUALT_SIZE);
     }
     return result;
 }
 
+void *
+da_grow(void *a, u32 stride) {
+    return da_grow_to(a, stride, da_capacity(a) + 1);
+}
+
 void 
 da_free_(void *a, u32 stride) {
     DArray_Header *header = da_header(a);
-    u64 old_size = sizeof(*header) + header->capacity * stride;
-    mem_free(header, old_size);    
+    if (header->flags & DA_FLAG_VIRTUAL) {
+        mem_release(header);
+    } else if (header->flags & DA_FLAG_ARENA) {
+        // Memory is released with arena
+    } else {
+        u64 old_size = sizeof(*header) + header->capacity * stride;
+        mem_free(header, old_size);    
+    }
 }
\ No newline at end of file
@@ -44,9 +44,26 @@ do {\
 (_node)->next->prev = (_node)->prev;\
 } while (0);
 
+// Dynamic arrays.
+// Array is represented as pointer to its first element, and header is stored right before it.
+// By default array memory is allocated with mem_alloc, but header can also record 
+// different allocation strategy that array was created with.
+enum {
+    // Array memory is reserved with mem_reserve, so it can grow without moving
+    DA_FLAG_VIRTUAL = 0x1,
+    // Array memory is taken from arena. Array is not freed individually, but discarded together 
+    // with arena (when it is reset or temporary memory ends)
+    DA_FLAG_ARENA   = 0x2,
+};
+
 typedef struct {
     u32 size;
     u32 capacity;
+    u32 flags;
+    // Maximum capacity array can grow to without moving. Only used for virtual arrays
+    u32 max_capacity;
+    // Only used for arena arrays
+    Memory_Arena *arena;
 } DArray_Header;
 
 #define da_header(_da) ((DArray_Header *)((u8 *)(_da) - sizeof(DArray_Header)))
@@ -58,8 +75,43 @@ do { \
     da_is_full(_da) ? (_da) = da_grow((_da), sizeof(*(_da))) : (void)0; \
     (_da)[da_header(_da)->size++] = (_it); \
 } while(0);
+// Make sure array has space for _count more elements, so they can be pushed with da_push_unchecked
+// without checking capacity on each push
+#define da_ensure(_da, _count) \
+do { \
+    (da_size(_da) + (_count) > da_capacity(_da)) ? \
+        (_da) = da_grow_to((_da), sizeof(*(_da)), da_size(_da) + (_count)) : (void)0; \
+} while (0);
+#define da_push_unchecked(_da, _it) \
+do { \
+    assert(da_header(_da)->size < da_header(_da)->capacity); \
+    (_da)[da_header(_da)->size++] = (_it); \
+} while (0);
+// Copy _count elements from _items to the end of array.
+// Empty batch does not touch array, which may still be null
+#define da_push_n(_da, _items, _count) \
+do { \
+    if (_count) { \
+        da_ensure(_da, _count); \
+        mem_copy((_da) + da_header(_da)->size, (_items), (_count) * sizeof(*(_da))); \
+        da_header(_da)->size += (_count); \
+    } \
+} while (0);
+// Remove last element and return it. Array must not be empty
+#define da_pop(_da) ((_da)[--da_header(_da)->size])
+#define da_clear(_da) ((_da) ? (void)(da_header(_da)->size = 0) : (void)0)
 #define da_reserve(_type, _size) da_reserve_(sizeof(_type), _size)
+// Create array with stable base address. Address space for max_count elements is reserved 
+// upfront and committed as array grows, so growth never copies and pointers to elements stay valid
+#define da_reserve_virtual(_type, _size, _max_count) da_reserve_virtual_(sizeof(_type), _size, _max_count)
+// Create array that lives in arena.
+// If array is the last allocation in arena, it grows in place
+#define da_reserve_arena(_type, _size, _arena) da_reserve_arena_(sizeof(_type), _size, _arena)
 #define da_free(_da) da_free_((_da), sizeof(*(_da)))
 void *da_reserve_(u32 stride, u32 count);
+void *da_reserve_virtual_(u32 stride, u32 count, u32 max_count);
+void *da_reserve_arena_(u32 stride, u32 count, Memory_Arena *arena);
 void *da_grow(void *a, u32 stride);
+// Grow array so its capacity is at least min_capacity
+void *da_grow_to(void *a, u32 stride, u32 min_capacity);
 void da_free_(void *a, u32 stride);
\ No newline at end of file
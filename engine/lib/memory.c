@@ -2,37 +2,804 @@
 
 #include "strings.h"
 #include "lists.h"
+#include "platform/os.h"
 
 #include <string.h> // memset, memcpy, memmove
 #include <stdlib.h> // malloc, free
+#include <stdatomic.h>
 
-void *mem_alloc(uptr size) {
+#define VIRTUAL_BLOCK_MAGIC 0x4B4C4256 // 'VBLK'
+
+// Header of virtual memory block. Stored in the page preceding memory given to user
+typedef struct {
+    // Lets mem_free check that block given to it is virtual block
+    u32 magic;
+    // Reservation, used to release the block
+    u8 *base;
+    uptr reserved;
+    // Number of bytes after header user can commit up to
+    uptr limit;
+    // Number of bytes after header that are committed
+    uptr committed;
+    // Highest size block has been used at. Committed pages past it have never been written to, 
+    // so they are still zero
+    uptr dirty;
+} Virtual_Block_Header;
+
+static uptr 
+get_page_size(void) {
+    static uptr page_size;
+    if (!page_size) {
+        page_size = os_get_page_size();
+    }
+    return page_size;
+}
+
+static Virtual_Block_Header *
+get_virtual_header(void *ptr) {
+    return (Virtual_Block_Header *)((u8 *)ptr - get_page_size());
+}
+
+// Checks that pointer given to allocator function belongs to it. Only compiled in internal builds, 
+// because they call functions, and release assert only tells compiler to assume expression
+#if INTERNAL_BUILD
+#define ASSERT_BLOCK(_expr) assert(_expr)
+#else 
+#define ASSERT_BLOCK(_expr) 
+#endif 
+
+// Virtual blocks are page-aligned, so header is only read for pointers that could be one
+static bool 
+is_virtual_block(void *ptr) {
+    return ((uptr)ptr & (get_page_size() - 1)) == 0 && get_virtual_header(ptr)->magic == VIRTUAL_BLOCK_MAGIC;
+}
+
+#if MEMORY_TRACKING
+// Allocation tracker. 
+// Every allocation is recorded in open-addressing hash table keyed by pointer. Records are split 
+// between MEMORY_TRACKER_SHARD_COUNT tables by pointer hash, each with its own lock, so threads 
+// that allocate at the same time almost never wait for each other. Shard is chosen by pointer and 
+// not by thread, because block can be freed on other thread than it was allocated on.
+// Statistics are atomic counters, so they are not guarded by any lock.
+// Table storage is taken from libc directly, so tracker doesn't track itself.
+#define MEMORY_TRACKER_SHARD_COUNT 64
+
+typedef struct {
+    // 0 means empty slot
+    void *ptr;
+    uptr size;
+    const char *file;
+    u32 line;
+    u32 tag;
+} Memory_Allocation_Record;
+
+typedef struct {
+    // Shards are locked by different threads, so each is kept in its own cache line
+    _Alignas(64) atomic_flag lock;
+    u32 capacity;
+    u32 count;
+    Memory_Allocation_Record *records;
+} Memory_Tracker_Shard;
+
+typedef struct {
+    _Atomic(uptr) live_bytes;
+    _Atomic(uptr) live_count;
+    _Atomic(uptr) peak_bytes;
+    _Atomic(u64) total_allocations;
+} Memory_Tag_Counters;
+
+typedef struct {
+    Memory_Tracker_Shard shards[MEMORY_TRACKER_SHARD_COUNT];
+    Memory_Tag_Counters tags[MEMORY_TAG_COUNT];
+    _Atomic(uptr) live_bytes;
+    _Atomic(uptr) peak_bytes;
+    _Atomic(uptr) frame_peak_bytes;
+    _Atomic(uptr) last_frame_peak_bytes;
+} Memory_Tracker;
+
+static Memory_Tracker tracker;
+
+static const char *MEMORY_TAG_NAMES[] = {
+    "General",
+    "Arena",
+    "DArray",
+    "Hash",
+    "String",
+};
+CT_ASSERT(ARRAY_SIZE(MEMORY_TAG_NAMES) == MEMORY_TAG_COUNT);
+
+static u64 
+tracker_hash(void *ptr) {
+    return ((uptr)ptr >> 4) * 0x9E3779B97F4A7C15llu;
+}
+
+// Top bits of hash select shard, and bits below them select slot in shard
+static Memory_Tracker_Shard *
+tracker_get_shard(void *ptr) {
+    CT_ASSERT(MEMORY_TRACKER_SHARD_COUNT == 64);
+    return tracker.shards + (tracker_hash(ptr) >> 58);
+}
+
+static void 
+tracker_begin(Memory_Tracker_Shard *shard) {
+    while (atomic_flag_test_and_set_explicit(&shard->lock, memory_order_acquire)) {
+    }
+}
+
+static void 
+tracker_end(Memory_Tracker_Shard *shard) {
+    atomic_flag_clear_explicit(&shard->lock, memory_order_release);
+}
+
+static u32 
+tracker_hash_idx(Memory_Tracker_Shard *shard, void *ptr) {
+    return (u32)(tracker_hash(ptr) >> 20) & (shard->capacity - 1);
+}
+
+static void tracker_insert(Memory_Tracker_Shard *shard, Memory_Allocation_Record record);
+
+static void 
+tracker_grow(Memory_Tracker_Shard *shard) {
+    u32 old_capacity = shard->capacity;
+    Memory_Allocation_Record *old_records = shard->records;
+    shard->capacity = old_capacity ? old_capacity * 2 : 256;
+    shard->records = calloc(shard->capacity, sizeof(Memory_Allocation_Record));
+    assert(shard->records);
+    shard->count = 0;
+    for (u32 i = 0; i < old_capacity; ++i) {
+        if (old_records[i].ptr) {
+            tracker_insert(shard, old_records[i]);
+        }
+    }
+    free(old_records);
+}
+
+static void 
+tracker_insert(Memory_Tracker_Shard *shard, Memory_Allocation_Record record) {
+    // Keep load factor under 0.5
+    if ((shard->count + 1) * 2 > shard->capacity) {
+        tracker_grow(shard);
+    }
+    u32 mask = shard->capacity - 1;
+    u32 idx = tracker_hash_idx(shard, record.ptr);
+    while (shard->records[idx].ptr) {
+        assert(shard->records[idx].ptr != record.ptr);
+        idx = (idx + 1) & mask;
+    }
+    shard->records[idx] = record;
+    ++shard->count;
+}
+
+static Memory_Allocation_Record *
+tracker_find(Memory_Tracker_Shard *shard, void *ptr) {
+    Memory_Allocation_Record *result = 0;
+    if (shard->capacity) {
+        u32 mask = shard->capacity - 1;
+        u32 idx = tracker_hash_idx(shard, ptr);
+        while (shard->records[idx].ptr) {
+            if (shard->records[idx].ptr == ptr) {
+                result = shard->records + idx;
+                break;
+            }
+            idx = (idx + 1) & mask;
+        }
+    }
+    return result;
+}
+
+// Deletion with backward shift, so table never needs tombstones
+static void 
+tracker_remove(Memory_Tracker_Shard *shard, Memory_Allocation_Record *record) {
+    u32 mask = shard->capacity - 1;
+    u32 hole = (u32)(record - shard->records);
+    u32 idx = (hole + 1) & mask;
+    while (shard->records[idx].ptr) {
+        u32 home = tracker_hash_idx(shard, shard->records[idx].ptr);
+        // Move record to the hole if hole lies between its home slot and current position
+        if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+            shard->records[hole] = shard->records[idx];
+            hole = idx;
+        }
+        idx = (idx + 1) & mask;
+    }
+    shard->records[hole].ptr = 0;
+    --shard->count;
+}
+
+static void 
+track_max(_Atomic(uptr) *peak, uptr value) {
+    uptr current = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > current && !atomic_compare_exchange_weak_explicit(peak, &current, value, 
+        memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Unsigned wraparound makes adding new_size - old_size work for shrinking too
+static void 
+track_size_change(u32 tag, uptr old_size, uptr new_size) {
+    Memory_Tag_Counters *tag_counters = tracker.tags + tag;
+    uptr delta = new_size - old_size;
+    uptr tag_live_bytes = atomic_fetch_add_explicit(&tag_counters->live_bytes, delta, memory_order_relaxed) + delta;
+    uptr live_bytes = atomic_fetch_add_explicit(&tracker.live_bytes, delta, memory_order_relaxed) + delta;
+    if (new_size > old_size) {
+        track_max(&tag_counters->peak_bytes, tag_live_bytes);
+        track_max(&tracker.peak_bytes, live_bytes);
+        track_max(&tracker.frame_peak_bytes, live_bytes);
+    }
+}
+
+static void 
+track_alloc(void *ptr, uptr size, u32 tag, const char *file, u32 line) {
+    tag &= MEMORY_TAG_MASK;
+    assert(tag < MEMORY_TAG_COUNT);
+    Memory_Allocation_Record record;
+    record.ptr = ptr;
+    record.size = size;
+    record.file = file;
+    record.line = line;
+    record.tag = tag;
+    Memory_Tracker_Shard *shard = tracker_get_shard(ptr);
+    tracker_begin(shard);
+    tracker_insert(shard, record);
+    tracker_end(shard);
+    
+    Memory_Tag_Counters *tag_counters = tracker.tags + tag;
+    atomic_fetch_add_explicit(&tag_counters->live_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tag_counters->total_allocations, 1, memory_order_relaxed);
+    track_size_change(tag, 0, size);
+}
+
+static void 
+track_free(void *ptr, uptr size) {
+    Memory_Tracker_Shard *shard = tracker_get_shard(ptr);
+    tracker_begin(shard);
+    Memory_Allocation_Record *record = tracker_find(shard, ptr);
+    // Freeing memory that was not allocated with mem_alloc
+    assert(record);
+    if (record) {
+        // Size passed to mem_free does not match allocated size
+        assert(record->size == size);
+        u32 tag = record->tag;
+        uptr record_size = record->size;
+        tracker_remove(shard, record);
+        tracker_end(shard);
+        atomic_fetch_sub_explicit(&tracker.tags[tag].live_count, 1, memory_order_relaxed);
+        track_size_change(tag, record_size, 0);
+    } else {
+        tracker_end(shard);
+    }
+}
+
+static void 
+track_resize(void *ptr, uptr size) {
+    Memory_Tracker_Shard *shard = tracker_get_shard(ptr);
+    tracker_begin(shard);
+    Memory_Allocation_Record *record = tracker_find(shard, ptr);
+    if (record) {
+        u32 tag = record->tag;
+        uptr old_size = record->size;
+        record->size = size;
+        tracker_end(shard);
+        track_size_change(tag, old_size, size);
+    } else {
+        tracker_end(shard);
+    }
+}
+
+static uptr 
+track_get_size(void *ptr) {
+    Memory_Tracker_Shard *shard = tracker_get_shard(ptr);
+    tracker_begin(shard);
+    Memory_Allocation_Record *record = tracker_find(shard, ptr);
+    assert(record);
+    uptr result = record ? record->size : 0;
+    tracker_end(shard);
+    return result;
+}
+
+#define TRACK_ALLOC(_ptr, _size, _tag) track_alloc(_ptr, _size, _tag, file, line)
+#define TRACK_FREE(_ptr, _size) track_free(_ptr, _size)
+#define TRACK_RESIZE(_ptr, _size) track_resize(_ptr, _size)
+#else 
+#define TRACK_ALLOC(_ptr, _size, _tag) (UNUSED(file), UNUSED(line), UNUSED(_tag))
+#define TRACK_FREE(_ptr, _size) 
+#define TRACK_RESIZE(_ptr, _size) 
+#endif 
+
+static void *
+mem_reserve_internal(uptr max_size, uptr commit_size, u32 flags) {
+    assert(commit_size <= max_size);
+    uptr page_size = get_page_size();
+    uptr limit = align_forward_pow2(max_size, page_size);
+    uptr reserved = page_size + limit;
+    bool use_huge_pages = (flags & MEMORY_FLAG_HUGE_PAGES) && max_size >= MEM_HUGE_PAGE_SIZE;
+    if (use_huge_pages) {
+        // Reserve additional space so user memory can start at huge page boundary
+        reserved += MEM_HUGE_PAGE_SIZE;
+    }
+    u8 *base = os_reserve_memory(reserved);
+    assert(base);
+    u8 *ptr = base + page_size;
+    if (use_huge_pages) {
+        ptr = (u8 *)align_forward_pow2((uptr)ptr, MEM_HUGE_PAGE_SIZE);
+        // If os does not support huge pages, memory just stays in regular ones
+        os_advise_huge_pages(ptr, limit);
+    }
+    Virtual_Block_Header *header = get_virtual_header(ptr);
+    // Header page is committed together with requested memory
+    uptr committed = align_forward_pow2(commit_size, page_size);
+    bool is_committed = os_commit_memory(header, page_size + committed);
+    assert(is_committed);
+    UNUSED(is_committed);
+    header->magic = VIRTUAL_BLOCK_MAGIC;
+    header->base = base;
+    header->reserved = reserved;
+    header->limit = limit;
+    header->committed = committed;
+    header->dirty = commit_size;
+    return ptr;
+}
+
+static bool 
+mem_commit_internal(void *ptr, uptr size) {
+    bool result = false;
+    ASSERT_BLOCK(is_virtual_block(ptr));
+    Virtual_Block_Header *header = get_virtual_header(ptr);
+    uptr required = align_forward_pow2(size, get_page_size());
+    if (required <= header->committed) {
+        result = true;
+    } else if (required <= header->limit) {
+        result = os_commit_memory((u8 *)ptr + header->committed, required - header->committed);
+        if (result) {
+            header->committed = required;
+        }
+    }
+    return result;
+}
+
+static void 
+mem_release_internal(void *ptr) {
+    ASSERT_BLOCK(is_virtual_block(ptr));
+    Virtual_Block_Header *header = get_virtual_header(ptr);
+    header->magic = 0;
+    os_release_memory(header->base, header->reserved);
+}
+
+// Small block allocator.
+// Allocations up to MEM_SMALL_THRESHOLD bytes are rounded up to one of size classes and served from 
+// per-thread free lists, so fast path is a pop from thread-local list without any locking.
+// Blocks move between threads in fixed-size batches through central depot, which has spin lock 
+// per size class. When depot is empty, new batch is carved from span of fresh pages.
+// Because mem_free is given allocation size, blocks don't need any headers.
+// All spans are taken from single address range reserved on first use, and size class of each span
+// is recorded, so mem_free can check that given size matches the block.
+// Size classes are 16-byte steps up to 128 bytes, and then 4 steps per power of two
+#define SMALL_CLASS_COUNT 28
+#define SMALL_SPAN_SIZE KB(64)
+#define SMALL_BATCH_BYTES KB(8)
+#define SMALL_REGION_SIZE GB(64)
+#define SMALL_REGION_SPAN_COUNT (SMALL_REGION_SIZE / SMALL_SPAN_SIZE)
+
+typedef struct Small_Block {
+    struct Small_Block *next;
+    // Only valid for first block of batch in depot
+    struct Small_Block *next_batch;
+} Small_Block;
+
+typedef struct {
+    atomic_flag lock;
+    Small_Block *batches;
+    // Blocks given back by exiting threads, that don't make up whole batch yet
+    Small_Block *loose_blocks;
+    u32 loose_count;
+    u8 *span;
+    uptr span_used;
+} Small_Depot;
+
+typedef struct {
+    Small_Block *free_list;
+    u32 count;
+} Small_Thread_Cache;
+
+static Small_Depot small_depots[SMALL_CLASS_COUNT];
+static _Thread_local Small_Thread_Cache small_thread_caches[SMALL_CLASS_COUNT];
+static _Atomic(u8 *) small_region;
+static _Atomic(uptr) small_region_span_count;
+static u8 small_span_classes[SMALL_REGION_SPAN_COUNT];
+
+static u8 *
+small_new_span(u32 class_idx) {
+    u8 *region = atomic_load_explicit(&small_region, memory_order_acquire);
+    if (!region) {
+        // Only address space is reserved, so region can be big enough to never run out
+        u8 *new_region = os_reserve_memory(SMALL_REGION_SIZE);
+        assert(new_region);
+        if (atomic_compare_exchange_strong(&small_region, &region, new_region)) {
+            region = new_region;
+        } else {
+            // Other thread has reserved region first
+            os_release_memory(new_region, SMALL_REGION_SIZE);
+        }
+    }
+    uptr span_idx = atomic_fetch_add(&small_region_span_count, 1);
+    assert(span_idx < SMALL_REGION_SPAN_COUNT);
+    u8 *span = region + span_idx * SMALL_SPAN_SIZE;
+    bool is_committed = os_commit_memory(span, SMALL_SPAN_SIZE);
+    assert(is_committed);
+    UNUSED(is_committed);
+    small_span_classes[span_idx] = (u8)class_idx;
+    return span;
+}
+
+static bool 
+is_small_block(void *ptr) {
+    u8 *region = atomic_load_explicit(&small_region, memory_order_relaxed);
+    return region && (u8 *)ptr >= region && (u8 *)ptr < region + SMALL_REGION_SIZE;
+}
+
+static bool 
+is_small_block_of_class(void *ptr, u32 class_idx) {
+    return is_small_block(ptr) && 
+        small_span_classes[((u8 *)ptr - atomic_load_explicit(&small_region, memory_order_relaxed)) / SMALL_SPAN_SIZE] == class_idx;
+}
+
+static u32 
+get_small_class(uptr size) {
+    u32 result = 0;
+    if (size <= 128) {
+        result = size ? (u32)((size - 1) >> 4) : 0;
+    } else {
+        u32 log = 63 - __builtin_clzll(size - 1);
+        u32 sub = (u32)((size - 1) >> (log - 2)) & 3;
+        result = 8 + (log - 7) * 4 + sub;
+    }
+    assert(result < SMALL_CLASS_COUNT);
+    return result;
+}
+
+static uptr 
+get_small_class_size(u32 class_idx) {
+    uptr result = 0;
+    if (class_idx < 8) {
+        result = (class_idx + 1) * 16;
+    } else {
+        u32 group = (class_idx - 8) >> 2;
+        u32 sub = (class_idx - 8) & 3;
+        result = ((uptr)128 << group) + (sub + 1) * ((uptr)32 << group);
+    }
+    return result;
+}
+
+static u32 
+get_small_batch_count(u32 class_idx) {
+    uptr result = SMALL_BATCH_BYTES / get_small_class_size(class_idx);
+    if (result < 4) {
+        result = 4;
+    } else if (result > 64) {
+        result = 64;
+    }
+    return (u32)result;
+}
+
+static void 
+small_depot_lock(Small_Depot *depot) {
+    while (atomic_flag_test_and_set_explicit(&depot->lock, memory_order_acquire)) {
+    }
+}
+
+static void 
+small_depot_unlock(Small_Depot *depot) {
+    atomic_flag_clear_explicit(&depot->lock, memory_order_release);
+}
+
+// Get batch of blocks from depot, carving new one from span if there are no free batches
+static Small_Block *
+small_depot_pop_batch(u32 class_idx) {
+    Small_Depot *depot = small_depots + class_idx;
+    small_depot_lock(depot);
+    Small_Block *batch = depot->batches;
+    if (batch) {
+        depot->batches = batch->next_batch;
+    } else {
+        uptr block_size = get_small_class_size(class_idx);
+        u32 batch_count = get_small_batch_count(class_idx);
+        uptr batch_size = block_size * batch_count;
+        if (!depot->span || depot->span_used + batch_size > SMALL_SPAN_SIZE) {
+            depot->span = small_new_span(class_idx);
+            depot->span_used = 0;
+        }
+        u8 *cursor = depot->span + depot->span_used;
+        depot->span_used += batch_size;
+        batch = (Small_Block *)cursor;
+        for (u32 i = 0; i < batch_count - 1; ++i) {
+            ((Small_Block *)cursor)->next = (Small_Block *)(cursor + block_size);
+            cursor += block_size;
+        }
+        ((Small_Block *)cursor)->next = 0;
+    }
+    small_depot_unlock(depot);
+    return batch;
+}
+
+static void 
+small_depot_push_batch(u32 class_idx, Small_Block *batch) {
+    Small_Depot *depot = small_depots + class_idx;
+    small_depot_lock(depot);
+    batch->next_batch = depot->batches;
+    depot->batches = batch;
+    small_depot_unlock(depot);
+}
+
+static void *
+small_alloc(u32 class_idx) {
+    Small_Thread_Cache *cache = small_thread_caches + class_idx;
+    if (!cache->free_list) {
+        cache->free_list = small_depot_pop_batch(class_idx);
+        cache->count = get_small_batch_count(class_idx);
+    }
+    Small_Block *block = cache->free_list;
+    cache->free_list = block->next;
+    --cache->count;
+    return block;
+}
+
+static void 
+small_free(u32 class_idx, void *ptr) {
+    Small_Thread_Cache *cache = small_thread_caches + class_idx;
+    Small_Block *block = ptr;
+    block->next = cache->free_list;
+    cache->free_list = block;
+    ++cache->count;
+    // Give batch back to depot when thread has accumulated two batches worth of blocks,
+    // so memory freed on one thread can be reused by others
+    u32 batch_count = get_small_batch_count(class_idx);
+    if (cache->count >= batch_count * 2) {
+        Small_Block *batch = cache->free_list;
+        Small_Block *last = batch;
+        for (u32 i = 0; i < batch_count - 1; ++i) {
+            last = last->next;
+        }
+        cache->free_list = last->next;
+        last->next = 0;
+        cache->count -= batch_count;
+        small_depot_push_batch(class_idx, batch);
+    }
+}
+
+void 
+mem_flush_thread_cache(void) {
+    for (u32 class_idx = 0; class_idx < SMALL_CLASS_COUNT; ++class_idx) {
+        Small_Thread_Cache *cache = small_thread_caches + class_idx;
+        if (cache->free_list) {
+            u32 batch_count = get_small_batch_count(class_idx);
+            Small_Depot *depot = small_depots + class_idx;
+            small_depot_lock(depot);
+            while (cache->free_list) {
+                Small_Block *block = cache->free_list;
+                cache->free_list = block->next;
+                block->next = depot->loose_blocks;
+                depot->loose_blocks = block;
+                if (++depot->loose_count == batch_count) {
+                    depot->loose_blocks->next_batch = depot->batches;
+                    depot->batches = depot->loose_blocks;
+                    depot->loose_blocks = 0;
+                    depot->loose_count = 0;
+                }
+            }
+            small_depot_unlock(depot);
+            cache->count = 0;
+        }
+    }
+}
+
+static void *
+mem_alloc_internal(uptr size, bool zero, u32 flags) {
     void *result = 0;
-    result = malloc(size);
+    if (size <= MEM_SMALL_THRESHOLD) {
+        result = small_alloc(get_small_class(size));
+        if (zero) {
+            mem_zero(result, size);
+        }
+    } else if (size >= MEM_VIRTUAL_THRESHOLD) {
+        // Pages that come from os are already zeroed
+        result = mem_reserve_internal(size, size, flags);
+    } else if (zero) {
+        // calloc can skip zeroing memory it knows is fresh
+        result = calloc(1, size);
+    } else {
+        result = malloc(size);
+    }
     assert(result);
-    mem_zero(result, size);
     return result;
 }
 
-void mem_free(void *ptr, uptr size) {
-    (void)size;
-    free(ptr);
+// Allocator block is returned to is chosen by size, so size that does not match the block would 
+// corrupt allocator. Asserts check that block actually belongs to it
+static void 
+mem_free_internal(void *ptr, uptr size) {
+    if (size <= MEM_SMALL_THRESHOLD) {
+        u32 class_idx = get_small_class(size);
+        ASSERT_BLOCK(is_small_block_of_class(ptr, class_idx));
+        small_free(class_idx, ptr);
+    } else if (size >= MEM_VIRTUAL_THRESHOLD) {
+        ASSERT_BLOCK(!is_small_block(ptr));
+        mem_release_internal(ptr);
+    } else {
+        ASSERT_BLOCK(!is_small_block(ptr));
+        free(ptr);
+    }
+}
+
+void *
+mem_reserve_(uptr max_size, uptr commit_size, u32 tag, const char *file, u32 line) {
+    void *result = mem_reserve_internal(max_size, commit_size, tag);
+    TRACK_ALLOC(result, commit_size, tag);
+    return result;
 }
 
-void *mem_realloc(void *ptr, uptr old_size, uptr size) {
-    void *new_ptr = mem_alloc(size);
-    mem_copy(new_ptr, ptr, old_size);
-    mem_free(ptr, old_size);
+bool 
+mem_commit(void *ptr, uptr size) {
+    bool result = mem_commit_internal(ptr, size);
+    if (result) {
+        TRACK_RESIZE(ptr, size);
+    }
+    return result;
+}
+
+void 
+mem_release(void *ptr) {
+#if MEMORY_TRACKING
+    track_free(ptr, track_get_size(ptr));
+#endif 
+    mem_release_internal(ptr);
+}
+
+void *
+mem_alloc_(uptr size, u32 tag, const char *file, u32 line) {
+    void *result = mem_alloc_internal(size, true, tag);
+    TRACK_ALLOC(result, size, tag);
+    return result;
+}
+
+void *
+mem_alloc_uninit_(uptr size, u32 tag, const char *file, u32 line) {
+    void *result = mem_alloc_internal(size, false, tag);
+    TRACK_ALLOC(result, size, tag);
+    return result;
+}
+
+void 
+mem_free(void *ptr, uptr size) {
+    // Same as free, null is accepted
+    if (ptr) {
+        TRACK_FREE(ptr, size);
+        mem_free_internal(ptr, size);
+    }
+}
+
+void *
+mem_realloc_(void *ptr, uptr old_size, uptr size, u32 tag, const char *file, u32 line) {
+    void *new_ptr = 0;
+    if (!ptr) {
+        // Same as realloc, null block is allocated fresh 
+        new_ptr = mem_alloc_internal(size, true, tag);
+    } else {
+        TRACK_FREE(ptr, old_size);
+        if (old_size >= MEM_VIRTUAL_THRESHOLD && size >= MEM_VIRTUAL_THRESHOLD && 
+            mem_commit_internal(ptr, size)) {
+            // Grown in place. Newly committed pages are zero, only bytes that were used before 
+            // block has been shrinked may contain old data
+            Virtual_Block_Header *header = get_virtual_header(ptr);
+            if (size > old_size && header->dirty > old_size) {
+                mem_zero((u8 *)ptr + old_size, (size < header->dirty ? size : header->dirty) - old_size);
+            }
+            if (size > header->dirty) {
+                header->dirty = size;
+            }
+            new_ptr = ptr;
+        } else if (old_size <= MEM_SMALL_THRESHOLD && size <= MEM_SMALL_THRESHOLD && 
+            get_small_class(old_size) == get_small_class(size)) {
+            // Block already has enough space
+            ASSERT_BLOCK(is_small_block_of_class(ptr, get_small_class(old_size)));
+            new_ptr = ptr;
+            if (size > old_size) {
+                mem_zero((u8 *)new_ptr + old_size, size - old_size);
+            }
+        } else {
+            if (size >= MEM_VIRTUAL_THRESHOLD) {
+                // Block that is reallocated is likely to grow again, so reserve space to grow in place.
+                // Pages are fresh, so the part not overwritten by copy is already zero
+                new_ptr = mem_reserve_internal(size * MEM_VIRTUAL_GROW_FACTOR, size, tag);
+            } else {
+                // Only the part not overwritten by copy needs zeroing 
+                new_ptr = mem_alloc_internal(size, false, tag);
+                if (size > old_size) {
+                    mem_zero((u8 *)new_ptr + old_size, size - old_size);
+                }
+            }
+            mem_copy(new_ptr, ptr, old_size < size ? old_size : size);
+            mem_free_internal(ptr, old_size);
+        }
+    }
+    TRACK_ALLOC(new_ptr, size, tag);
     return new_ptr;
 }
 
-char *mem_alloc_str(const char *str) {
+char *
+mem_alloc_str_(const char *str, const char *file, u32 line) {
     uptr len = str_len(str) + 1;
-    char *result = (char *)mem_alloc(len);
+    char *result = (char *)mem_alloc_uninit_(len, MEMORY_TAG_STRING, file, line);
     mem_copy(result, str, len);
     return result;    
 }
 
+uptr 
+mem_get_huge_page_bytes(void) {
+    return os_get_huge_page_usage();
+}
+
+Memory_Stats 
+mem_get_stats(void) {
+    Memory_Stats result = {0};
+#if MEMORY_TRACKING
+    for (u32 tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+        Memory_Tag_Counters *tag_counters = tracker.tags + tag;
+        Memory_Tag_Stats *tag_stats = result.tags + tag;
+        tag_stats->live_bytes = atomic_load_explicit(&tag_counters->live_bytes, memory_order_relaxed);
+        tag_stats->live_count = atomic_load_explicit(&tag_counters->live_count, memory_order_relaxed);
+        tag_stats->peak_bytes = atomic_load_explicit(&tag_counters->peak_bytes, memory_order_relaxed);
+        tag_stats->total_allocations = atomic_load_explicit(&tag_counters->total_allocations, memory_order_relaxed);
+    }
+    result.live_bytes = atomic_load_explicit(&tracker.live_bytes, memory_order_relaxed);
+    result.peak_bytes = atomic_load_explicit(&tracker.peak_bytes, memory_order_relaxed);
+    result.frame_peak_bytes = atomic_load_explicit(&tracker.frame_peak_bytes, memory_order_relaxed);
+    result.last_frame_peak_bytes = atomic_load_explicit(&tracker.last_frame_peak_bytes, memory_order_relaxed);
+#endif 
+    return result;
+}
+
+void 
+mem_begin_frame(void) {
+#if MEMORY_TRACKING
+    uptr live_bytes = atomic_load_explicit(&tracker.live_bytes, memory_order_relaxed);
+    uptr frame_peak_bytes = atomic_exchange_explicit(&tracker.frame_peak_bytes, live_bytes, memory_order_relaxed);
+    atomic_store_explicit(&tracker.last_frame_peak_bytes, frame_peak_bytes, memory_order_relaxed);
+#endif 
+}
+
+uptr 
+mem_report_leaks(void) {
+    uptr result = 0;
+#if MEMORY_TRACKING
+    Memory_Stats stats = mem_get_stats();
+    outf("Memory usage: %llu bytes live, %llu bytes peak\n", 
+        (unsigned long long)stats.live_bytes, (unsigned long long)stats.peak_bytes);
+    for (u32 tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+        Memory_Tag_Stats *tag_stats = stats.tags + tag;
+        outf("  %-8s: %llu bytes in %llu blocks live, %llu bytes peak, %llu allocations total\n",
+            MEMORY_TAG_NAMES[tag], (unsigned long long)tag_stats->live_bytes, 
+            (unsigned long long)tag_stats->live_count, (unsigned long long)tag_stats->peak_bytes, 
+            (unsigned long long)tag_stats->total_allocations);
+    }
+    outf("  Huge pages: %llu bytes\n", (unsigned long long)mem_get_huge_page_bytes());
+    for (u32 shard_idx = 0; shard_idx < MEMORY_TRACKER_SHARD_COUNT; ++shard_idx) {
+        Memory_Tracker_Shard *shard = tracker.shards + shard_idx;
+        tracker_begin(shard);
+        for (u32 i = 0; i < shard->capacity; ++i) {
+            Memory_Allocation_Record *record = shard->records + i;
+            if (record->ptr) {
+                outf("Unreleased %llu bytes (%s) allocated at %s:%u\n", 
+                    (unsigned long long)record->size, MEMORY_TAG_NAMES[record->tag], 
+                    record->file, record->line);
+                ++result;
+            }
+        }
+        tracker_end(shard);
+    }
+#endif 
+    return result;
+}
+
 void mem_copy(void *dst, const void *src, uptr size) {
     memcpy(dst, src, size);
 }
@@ -48,3 +815,138 @@ void mem_zero(void *dst, uptr size) {
 bool mem_eq(const void *a, const void *b, uptr n) {
     return memcmp(a, b, n) == 0;
 }
+
+static Memory_Block *
+arena_new_block(Memory_Arena *arena, uptr size, uptr align) {
+    uptr block_size = arena->minimum_block_size;
+    if (!block_size) {
+        block_size = MEMORY_ARENA_DEFAULT_BLOCK_SIZE;
+    }
+    // Reserve space for worst-case alignment padding
+    if (size + align > block_size) {
+        block_size = size + align;
+    }
+    if (arena->alloc_flags & MEMORY_FLAG_HUGE_PAGES) {
+        block_size = align_forward_pow2(sizeof(Memory_Block) + block_size, MEM_HUGE_PAGE_SIZE) - sizeof(Memory_Block);
+    }
+    // Arena does not guarantee zeroed memory, so there is no need to clear the block
+    Memory_Block *block = mem_alloc_uninit_tagged(sizeof(Memory_Block) + block_size, 
+        MEMORY_TAG_ARENA | arena->alloc_flags);
+    block->base = (u8 *)(block + 1);
+    block->size = block_size;
+    block->used = 0;
+    block->prev = arena->current_block;
+    arena->current_block = block;
+    return block;
+}
+
+static void 
+arena_free_last_block(Memory_Arena *arena) {
+    Memory_Block *block = arena->current_block;
+    arena->current_block = block->prev;
+    mem_free(block, sizeof(Memory_Block) + block->size);
+}
+
+static uptr 
+arena_get_alignment_offset(Memory_Block *block, uptr align) {
+    uptr current = (uptr)(block->base + block->used);
+    uptr result = align_forward_pow2(current, align) - current;
+    return result;
+}
+
+void *
+arena_push_aligned(Memory_Arena *arena, uptr size, uptr align) {
+    assert(IS_POW2(align));
+    Memory_Block *block = arena->current_block;
+    uptr offset = 0;
+    if (block) {
+        offset = arena_get_alignment_offset(block, align);
+    }
+    if (!block || block->used + offset + size > block->size) {
+        block = arena_new_block(arena, size, align);
+        offset = arena_get_alignment_offset(block, align);
+    }
+    
+    void *result = block->base + block->used + offset;
+    block->used += offset + size;
+    assert(block->used <= block->size);
+    return result;
+}
+
+void *
+arena_push(Memory_Arena *arena, uptr size) {
+    return arena_push_aligned(arena, size, MEMORY_DEFAULT_ALIGNMENT);
+}
+
+void *
+arena_push_zero(Memory_Arena *arena, uptr size) {
+    void *result = arena_push(arena, size);
+    mem_zero(result, size);
+    return result;
+}
+
+void 
+arena_pop(Memory_Arena *arena, uptr size) {
+    Memory_Block *block = arena->current_block;
+    assert(block && block->used >= size);
+    block->used -= size;
+}
+
+char *
+arena_push_str(Memory_Arena *arena, const char *str) {
+    uptr len = str_len(str) + 1;
+    char *result = arena_push_aligned(arena, len, 1);
+    mem_copy(result, str, len);
+    return result;
+}
+
+void 
+arena_clear(Memory_Arena *arena) {
+    assert(arena->temp_count == 0);
+    while (arena->current_block) {
+        arena_free_last_block(arena);
+    }
+}
+
+void 
+arena_reset(Memory_Arena *arena) {
+    assert(arena->temp_count == 0);
+    Memory_Block *block = arena->current_block;
+    if (block && block->prev) {
+        uptr total_size = 0;
+        while (arena->current_block) {
+            total_size += arena->current_block->size;
+            arena_free_last_block(arena);
+        }
+        uptr minimum_block_size = arena->minimum_block_size;
+        arena->minimum_block_size = total_size;
+        arena_new_block(arena, 0, 0);
+        arena->minimum_block_size = minimum_block_size;
+    } else if (block) {
+        block->used = 0;
+    }
+}
+
+Temp_Memory 
+begin_temp_memory(Memory_Arena *arena) {
+    Temp_Memory result;
+    result.arena = arena;
+    result.block = arena->current_block;
+    result.block_used = arena->current_block ? arena->current_block->used : 0;
+    ++arena->temp_count;
+    return result;
+}
+
+void 
+end_temp_memory(Temp_Memory temp) {
+    Memory_Arena *arena = temp.arena;
+    while (arena->current_block != temp.block) {
+        arena_free_last_block(arena);
+    }
+    if (arena->current_block) {
+        assert(arena->current_block->used >= temp.block_used);
+        arena->current_block->used = temp.block_used;
+    }
+    assert(arena->temp_count);
+    --arena->temp_count;
+}
@@ -4,23 +4,68 @@
 // Version: 0
 //
 // Defines memory-related functions, as well as block and arena allocator.
-// @NOTE All allocation functions set allocated memory to zero
+// @NOTE All allocation functions set allocated memory to zero, except for mem_alloc_uninit and 
+// arena_push, which leave it up to the caller
 #pragma once 
 #include "lib/general.h"
 #include "utils.h"
 
+// Allocations are tagged by their use, so memory usage can be accounted per subsystem
+enum {
+    MEMORY_TAG_GENERAL,
+    MEMORY_TAG_ARENA,
+    MEMORY_TAG_DARRAY,
+    MEMORY_TAG_HASH,
+    MEMORY_TAG_STRING,
+    MEMORY_TAG_COUNT
+};
+#define MEMORY_TAG_MASK 0xFF
+// Flags that can be combined with tag
+enum {
+    // Back block with huge pages if os supports it. Only applies to blocks allocated from virtual 
+    // memory. Used for big long-lived blocks that are accessed randomly, to reduce TLB misses
+    MEMORY_FLAG_HUGE_PAGES = 0x100,
+};
+
+// Allocation tracking records size, tag and call site of every allocation, so usage can be 
+// accounted per tag and leaks reported at shutdown. On in internal builds, can be turned off 
+// with -DMEMORY_TRACKING=0
+#ifndef MEMORY_TRACKING
+#define MEMORY_TRACKING INTERNAL_BUILD
+#endif 
+
+// With tracking every allocation records its call site, and allocation functions are wrapped 
+// in macros that supply it
+#if MEMORY_TRACKING
+#define MEM_CALL_SITE __FILE__, __LINE__
+#else 
+#define MEM_CALL_SITE 0, 0
+#endif
+
 // standard library-like functions
 // Unlike malloc, mem_alloc is guaranteed to return already zeroed memory
 // malloc
-#define mem_alloc_arr(_count, _type) (_type *)mem_alloc(_count * sizeof(_type))
+#define mem_alloc_arr(_count, _type) (_type *)mem_alloc((_count) * sizeof(_type))
+#define mem_alloc(_size) mem_alloc_(_size, MEMORY_TAG_GENERAL, MEM_CALL_SITE)
+#define mem_alloc_tagged(_size, _tag) mem_alloc_(_size, _tag, MEM_CALL_SITE)
 ATTR((malloc))
-void *mem_alloc(uptr size);
-// realloc
+void *mem_alloc_(uptr size, u32 tag, const char *file, u32 line);
+// Same as mem_alloc, but memory contents are undefined. 
+// Used when caller overwrites whole block anyway, so zeroing would only touch pages twice
+#define mem_alloc_uninit(_size) mem_alloc_uninit_(_size, MEMORY_TAG_GENERAL, MEM_CALL_SITE)
+#define mem_alloc_uninit_tagged(_size, _tag) mem_alloc_uninit_(_size, _tag, MEM_CALL_SITE)
 ATTR((malloc))
-void *mem_realloc(void *ptr, uptr old_size, uptr size);
+void *mem_alloc_uninit_(uptr size, u32 tag, const char *file, u32 line);
+// realloc. Only the part of block after old_size is zeroed
+// @NOTE Not marked as malloc, because block can be grown in place and returned pointer can alias ptr
+#define mem_realloc(_ptr, _old_size, _size) mem_realloc_(_ptr, _old_size, _size, MEMORY_TAG_GENERAL, MEM_CALL_SITE)
+#define mem_realloc_tagged(_ptr, _old_size, _size, _tag) mem_realloc_(_ptr, _old_size, _size, _tag, MEM_CALL_SITE)
+void *mem_realloc_(void *ptr, uptr old_size, uptr size, u32 tag, const char *file, u32 line);
 // strdup
-char *mem_alloc_str(const char *str);
+#define mem_alloc_str(_str) mem_alloc_str_(_str, MEM_CALL_SITE)
+char *mem_alloc_str_(const char *str, const char *file, u32 line);
 // free
+// size must be the same as the one block was allocated with. ptr can be null
 void mem_free(void *ptr, uptr size);
 // memcpy
 void mem_copy(void *dst, const void *src, uptr size);
@@ -30,3 +75,116 @@ void mem_move(void *dst, const void *src, uptr size);
 void mem_zero(void *dst, uptr size);
 // memcmp
 bool mem_eq(const void *a, const void *b, uptr n);
+
+// Allocations of this size and smaller are served by size-class allocator with per-thread caches,
+// so they don't contend on any lock in the common case
+#define MEM_SMALL_THRESHOLD KB(4)
+// Give blocks cached by calling thread back to shared pool. Must be called before thread exits, 
+// otherwise blocks it has freed are lost. Threads created with os_create_thread do this automatically
+void mem_flush_thread_cache(void);
+// Allocations of this size and bigger are made directly from virtual memory.
+// When mem_realloc has to move such block, it reserves MEM_VIRTUAL_GROW_FACTOR times more address 
+// space than requested, so following reallocs can grow it in place without copying. 
+// Blocks that are never reallocated only reserve what they use
+#define MEM_VIRTUAL_THRESHOLD KB(256)
+#define MEM_VIRTUAL_GROW_FACTOR 8
+#define MEM_HUGE_PAGE_SIZE MB(2)
+// Reserve address space for max_size bytes, committing only first commit_size bytes.
+// Returned memory is zeroed and page-aligned
+#define mem_reserve(_max_size, _commit_size) mem_reserve_(_max_size, _commit_size, MEMORY_TAG_GENERAL, MEM_CALL_SITE)
+#define mem_reserve_tagged(_max_size, _commit_size, _tag) mem_reserve_(_max_size, _commit_size, _tag, MEM_CALL_SITE)
+void *mem_reserve_(uptr max_size, uptr commit_size, u32 tag, const char *file, u32 line);
+// Make sure that first size bytes of reserved block are committed. Block is never moved,
+// false is returned if size exceeds reservation
+bool mem_commit(void *ptr, uptr size);
+// Free block created with mem_reserve
+void mem_release(void *ptr);
+// Number of bytes of process memory that os has actually backed with huge pages. Huge pages are 
+// given out by os at its discretion, so this can be less than what was allocated with 
+// MEMORY_FLAG_HUGE_PAGES. 0 if os does not report it
+uptr mem_get_huge_page_bytes(void);
+
+// Allocation statistics. Only collected with MEMORY_TRACKING, otherwise all values are zero
+typedef struct {
+    uptr live_bytes;
+    uptr live_count;
+    uptr peak_bytes;
+    u64 total_allocations;
+} Memory_Tag_Stats;
+
+typedef struct {
+    Memory_Tag_Stats tags[MEMORY_TAG_COUNT];
+    uptr live_bytes;
+    uptr peak_bytes;
+    // Highest number of live bytes during current frame
+    uptr frame_peak_bytes;
+    // frame_peak_bytes of the previous frame
+    uptr last_frame_peak_bytes;
+} Memory_Stats;
+
+// Counters are updated by all threads, so returned copy is only consistent if no other thread allocates
+Memory_Stats mem_get_stats(void);
+// Start new frame in statistics. Called by engine at the top of the main loop
+void mem_begin_frame(void);
+// Print usage statistics and all unreleased allocations with their call sites.
+// Returns number of unreleased allocations
+uptr mem_report_leaks(void);
+
+#define MEMORY_ARENA_DEFAULT_BLOCK_SIZE MB(1)
+#define MEMORY_DEFAULT_ALIGNMENT 16
+
+// Block of memory arena gives out allocations from. 
+// Header is stored at the start of the block, followed by size bytes of usable memory
+typedef struct Memory_Block {
+    struct Memory_Block *prev;
+    u8 *base;
+    uptr size;
+    uptr used;
+} Memory_Block;
+
+// Linear (bump) allocator. 
+// Memory is given out sequentially from blocks, which are allocated with mem_alloc when 
+// current block can't fit the allocation. Individual allocations can't be freed - 
+// all memory is released at once with arena_clear, or rolled back to saved point with
+// temporary memory.
+// Zero-initialized arena is valid, no explicit initialization is needed.
+typedef struct Memory_Arena {
+    Memory_Block *current_block;
+    // Size of new blocks. 0 means MEMORY_ARENA_DEFAULT_BLOCK_SIZE
+    uptr minimum_block_size;
+    // Number of active temporary memory scopes
+    u32 temp_count;
+    // MEMORY_FLAG_* used when allocating blocks. With MEMORY_FLAG_HUGE_PAGES block sizes are 
+    // rounded up to whole huge pages, because smaller blocks can't be backed by them
+    u32 alloc_flags;
+} Memory_Arena;
+
+// Saved arena state. All allocations made between begin_temp_memory and end_temp_memory
+// are released by end_temp_memory
+typedef struct {
+    Memory_Arena *arena;
+    Memory_Block *block;
+    uptr block_used;
+} Temp_Memory;
+
+#define arena_push_struct(_arena, _type) (_type *)arena_push_zero(_arena, sizeof(_type))
+#define arena_push_arr(_arena, _type, _count) (_type *)arena_push_zero(_arena, (_count) * sizeof(_type))
+// align must be power of two
+void *arena_push_aligned(Memory_Arena *arena, uptr size, uptr align);
+// Memory returned by arena_push is not zeroed
+void *arena_push(Memory_Arena *arena, uptr size);
+void *arena_push_zero(Memory_Arena *arena, uptr size);
+// Release last size bytes from current block. 
+// @NOTE Because of alignment padding this is only exact if last allocations were made with 
+// sizes that are multiple of alignment
+void arena_pop(Memory_Arena *arena, uptr size);
+char *arena_push_str(Memory_Arena *arena, const char *str);
+// Free all blocks owned by arena
+void arena_clear(Memory_Arena *arena);
+// Mark all memory in arena as unused, keeping it allocated. 
+// If arena has grown to several blocks, they are merged into one, so after a couple of resets
+// steady-state usage does not allocate at all
+void arena_reset(Memory_Arena *arena);
+
+Temp_Memory begin_temp_memory(Memory_Arena *arena);
+void end_temp_memory(Temp_Memory temp);
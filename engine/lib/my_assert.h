@@ -36,6 +36,8 @@
 #else
 #define assert(_expr) ASSUME(_expr)
 #endif
+// Checked in all builds. Used where continuing after failed check would corrupt memory
+#define assert_always(_expr) do { if (!(_expr)) { assert_msg(#_expr, __FILE__, __LINE__, __FUNCTION_NAME__); DBG_BREAKPOINT; } } while (0); (void)0
 void assert_msg(const char *expr, const char *filename, int line, const char *function);
 
 #define NOT_IMPLEMENTED DBG_BREAKPOINT
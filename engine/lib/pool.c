@@ -0,0 +1,86 @@
+#include "pool.h"
+#include "lists.h"
+
+#define POOL_HANDLE_IDX(_handle) ((u32)((_handle).value & 0xFFFFFFFF))
+#define POOL_HANDLE_GENERATION(_handle) ((u32)((_handle).value >> 32))
+
+static Pool_Handle 
+make_pool_handle(u32 idx, u32 generation) {
+    Pool_Handle handle;
+    handle.value = ((u64)generation << 32) | idx;
+    return handle;
+}
+
+static void *
+pool_slot(Pool *pool, u32 idx) {
+    return pool->storage + pool->stride * idx;
+}
+
+void 
+init_pool(Pool *pool, Memory_Arena *arena, uptr stride, u32 capacity) {
+    mem_zero(pool, sizeof(*pool));
+    if (stride < sizeof(Pool_Free_Slot)) {
+        stride = sizeof(Pool_Free_Slot);
+    }
+    pool->stride = align_forward(stride, sizeof(Pool_Free_Slot));
+    pool->capacity = capacity;
+    pool->storage = arena_push(arena, pool->stride * capacity);
+    pool->generations = arena_push_arr(arena, u32, capacity);
+}
+
+Pool_Handle 
+pool_alloc(Pool *pool) {
+    Pool_Handle result = {0};
+    void *slot = 0;
+    if (pool->free_list) {
+        slot = pool->free_list;
+        STACK_POP(pool->free_list);
+    } else if (pool->slots_used < pool->capacity) {
+        slot = pool_slot(pool, pool->slots_used++);
+    }
+    
+    if (slot) {
+        u32 idx = (u32)(((u8 *)slot - pool->storage) / pool->stride);
+        u32 generation = ++pool->generations[idx];
+        assert(generation & 1);
+        mem_zero(slot, pool->stride);
+        ++pool->count;
+        result = make_pool_handle(idx, generation);
+    }
+    return result;
+}
+
+void 
+pool_free(Pool *pool, Pool_Handle handle) {
+    Pool_Free_Slot *slot = pool_get(pool, handle);
+    if (slot) {
+        ++pool->generations[POOL_HANDLE_IDX(handle)];
+        --pool->count;
+        STACK_ADD(pool->free_list, slot);
+    }
+}
+
+void *
+pool_get(Pool *pool, Pool_Handle handle) {
+    void *result = 0;
+    if (pool_is_valid(pool, handle)) {
+        result = pool_slot(pool, POOL_HANDLE_IDX(handle));
+    }
+    return result;
+}
+
+bool 
+pool_is_valid(Pool *pool, Pool_Handle handle) {
+    u32 idx = POOL_HANDLE_IDX(handle);
+    u32 generation = POOL_HANDLE_GENERATION(handle);
+    return idx < pool->slots_used && (generation & 1) && pool->generations[idx] == generation;
+}
+
+void *
+pool_at(Pool *pool, u32 idx) {
+    void *result = 0;
+    if (idx < pool->slots_used && (pool->generations[idx] & 1)) {
+        result = pool_slot(pool, idx);
+    }
+    return result;
+}
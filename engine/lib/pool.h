@@ -0,0 +1,55 @@
+// Author: Holodome
+// Date: 17.10.2021 
+// File: engine/lib/pool.h
+// Version: 0
+// 
+// Fixed-size pool allocator.
+// Pool stores objects of same size in single contiguous array, so allocation and deallocation
+// are O(1) and don't touch the heap, and objects stay densely packed for iteration.
+// Freed slots are kept in intrusive free list, that is stored in the memory of freed objects 
+// themselves (so stride is at least pointer-sized).
+//
+// Objects are referenced with handles, which contain slot index and its generation. 
+// Generation is incremented every time slot is allocated or freed, so handles to objects that
+// were freed (and possibly reused) are detected as stale and not resolved.
+#pragma once
+#include "lib/general.h"
+#include "memory.h"
+
+// @NOTE 0 is not valid handle value
+typedef struct {
+    u64 value;
+} Pool_Handle;
+
+typedef struct Pool_Free_Slot {
+    struct Pool_Free_Slot *next;
+} Pool_Free_Slot;
+
+typedef struct {
+    uptr stride;
+    u32 capacity;
+    // Number of slots that have been used at least once. Slots after this are never touched, 
+    // so iteration can stop here
+    u32 slots_used;
+    // Number of currently allocated objects
+    u32 count;
+    u8 *storage;
+    // Odd generation means slot is occupied
+    u32 *generations;
+    Pool_Free_Slot *free_list;
+} Pool;
+
+#define init_pool_typed(_pool, _arena, _type, _capacity) init_pool(_pool, _arena, sizeof(_type), _capacity)
+#define pool_get_typed(_pool, _type, _handle) ((_type *)pool_get(_pool, _handle))
+// Storage for pool is taken from arena
+void init_pool(Pool *pool, Memory_Arena *arena, uptr stride, u32 capacity);
+// Allocates zeroed object. Returns 0 handle if pool is full
+Pool_Handle pool_alloc(Pool *pool);
+void pool_free(Pool *pool, Pool_Handle handle);
+// Returns 0 if handle is stale
+void *pool_get(Pool *pool, Pool_Handle handle);
+bool pool_is_valid(Pool *pool, Pool_Handle handle);
+// Used for iterating pool objects:
+// for (u32 i = 0; i < pool->slots_used; ++i) { Type *it = pool_at(pool, i); if (it) {...} }
+// Returns 0 if slot is free
+void *pool_at(Pool *pool, u32 idx);
@@ -0,0 +1,316 @@
+#include "serialization.h"
+#include "memory.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SERIALIZATION_BIG_ENDIAN_HOST 1
+#else
+#define SERIALIZATION_BIG_ENDIAN_HOST 0
+#endif
+
+// Conversion between host and little-endian order, same in both directions
+static u16
+le16(u16 value) {
+#if SERIALIZATION_BIG_ENDIAN_HOST
+    value = __builtin_bswap16(value);
+#endif
+    return value;
+}
+
+static u32
+le32(u32 value) {
+#if SERIALIZATION_BIG_ENDIAN_HOST
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+static u64
+le64(u64 value) {
+#if SERIALIZATION_BIG_ENDIAN_HOST
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+// Same as in_stream_read, but values that are already in buffer are copied without going through
+// peek and advance. Limits are chosen so that advance would not flush or finish stream here
+static bool
+serialization_read(InStream *stream, void *out, uptr size) {
+    bool result = false;
+    uptr end = stream->bf_idx + size;
+    if (end < stream->bf_used && end <= stream->threshold) {
+        mem_copy(out, stream->bf + stream->bf_idx, size);
+        stream->bf_idx = end;
+        result = true;
+    } else {
+        result = in_stream_read(stream, out, size) == size;
+    }
+    return result;
+}
+
+u64
+zigzag_encode(i64 value) {
+    return ((u64)value << 1) ^ (u64)(value >> 63);
+}
+
+i64
+zigzag_decode(u64 value) {
+    return (i64)(value >> 1) ^ -(i64)(value & 1);
+}
+
+bool
+out_stream_write_u8(OutStream *stream, u8 value) {
+    return out_streamb(stream, &value, sizeof(value)) == sizeof(value);
+}
+
+bool
+out_stream_write_u16(OutStream *stream, u16 value) {
+    value = le16(value);
+    return out_streamb(stream, &value, sizeof(value)) == sizeof(value);
+}
+
+bool
+out_stream_write_u32(OutStream *stream, u32 value) {
+    value = le32(value);
+    return out_streamb(stream, &value, sizeof(value)) == sizeof(value);
+}
+
+bool
+out_stream_write_u64(OutStream *stream, u64 value) {
+    value = le64(value);
+    return out_streamb(stream, &value, sizeof(value)) == sizeof(value);
+}
+
+bool
+out_stream_write_i8(OutStream *stream, i8 value) {
+    return out_stream_write_u8(stream, (u8)value);
+}
+
+bool
+out_stream_write_i16(OutStream *stream, i16 value) {
+    return out_stream_write_u16(stream, (u16)value);
+}
+
+bool
+out_stream_write_i32(OutStream *stream, i32 value) {
+    return out_stream_write_u32(stream, (u32)value);
+}
+
+bool
+out_stream_write_i64(OutStream *stream, i64 value) {
+    return out_stream_write_u64(stream, (u64)value);
+}
+
+bool
+out_stream_write_f32(OutStream *stream, f32 value) {
+    u32 bits;
+    mem_copy(&bits, &value, sizeof(bits));
+    return out_stream_write_u32(stream, bits);
+}
+
+bool
+out_stream_write_f64(OutStream *stream, f64 value) {
+    u64 bits;
+    mem_copy(&bits, &value, sizeof(bits));
+    return out_stream_write_u64(stream, bits);
+}
+
+bool
+out_stream_write_varint(OutStream *stream, u64 value) {
+    u8 bytes[VARINT_MAX_SIZE];
+    uptr size = 0;
+    while (value >= 0x80) {
+        bytes[size++] = (u8)value | 0x80;
+        value >>= 7;
+    }
+    bytes[size++] = (u8)value;
+    return out_streamb(stream, bytes, size) == size;
+}
+
+bool
+out_stream_write_zigzag(OutStream *stream, i64 value) {
+    return out_stream_write_varint(stream, zigzag_encode(value));
+}
+
+bool
+out_stream_write_array(OutStream *stream, const void *data, uptr elem_size, uptr count) {
+    assert(elem_size == 1 || elem_size == 2 || elem_size == 4 || elem_size == 8);
+    bool result = true;
+    if (!SERIALIZATION_BIG_ENDIAN_HOST || elem_size == 1) {
+        result = out_streamb(stream, data, elem_size * count) == elem_size * count;
+    } else {
+        const u8 *cursor = data;
+        for (uptr elem_idx = 0; result && elem_idx < count; ++elem_idx, cursor += elem_size) {
+            if (elem_size == 2) {
+                u16 value;
+                mem_copy(&value, cursor, sizeof(value));
+                result = out_stream_write_u16(stream, value);
+            } else if (elem_size == 4) {
+                u32 value;
+                mem_copy(&value, cursor, sizeof(value));
+                result = out_stream_write_u32(stream, value);
+            } else {
+                u64 value;
+                mem_copy(&value, cursor, sizeof(value));
+                result = out_stream_write_u64(stream, value);
+            }
+        }
+    }
+    return result;
+}
+
+bool
+in_stream_read_u8(InStream *stream, u8 *value) {
+    *value = 0;
+    return serialization_read(stream, value, sizeof(*value));
+}
+
+bool
+in_stream_read_u16(InStream *stream, u16 *value) {
+    u16 bits = 0;
+    bool result = serialization_read(stream, &bits, sizeof(bits));
+    *value = result ? le16(bits) : 0;
+    return result;
+}
+
+bool
+in_stream_read_u32(InStream *stream, u32 *value) {
+    u32 bits = 0;
+    bool result = serialization_read(stream, &bits, sizeof(bits));
+    *value = result ? le32(bits) : 0;
+    return result;
+}
+
+bool
+in_stream_read_u64(InStream *stream, u64 *value) {
+    u64 bits = 0;
+    bool result = serialization_read(stream, &bits, sizeof(bits));
+    *value = result ? le64(bits) : 0;
+    return result;
+}
+
+bool
+in_stream_read_i8(InStream *stream, i8 *value) {
+    u8 bits;
+    bool result = in_stream_read_u8(stream, &bits);
+    *value = (i8)bits;
+    return result;
+}
+
+bool
+in_stream_read_i16(InStream *stream, i16 *value) {
+    u16 bits;
+    bool result = in_stream_read_u16(stream, &bits);
+    *value = (i16)bits;
+    return result;
+}
+
+bool
+in_stream_read_i32(InStream *stream, i32 *value) {
+    u32 bits;
+    bool result = in_stream_read_u32(stream, &bits);
+    *value = (i32)bits;
+    return result;
+}
+
+bool
+in_stream_read_i64(InStream *stream, i64 *value) {
+    u64 bits;
+    bool result = in_stream_read_u64(stream, &bits);
+    *value = (i64)bits;
+    return result;
+}
+
+bool
+in_stream_read_f32(InStream *stream, f32 *value) {
+    u32 bits;
+    bool result = in_stream_read_u32(stream, &bits);
+    mem_copy(value, &bits, sizeof(bits));
+    return result;
+}
+
+bool
+in_stream_read_f64(InStream *stream, f64 *value) {
+    u64 bits;
+    bool result = in_stream_read_u64(stream, &bits);
+    mem_copy(value, &bits, sizeof(bits));
+    return result;
+}
+
+bool
+in_stream_read_varint(InStream *stream, u64 *value) {
+    bool result = false;
+    u64 decoded = 0;
+    const u8 *bytes;
+    uptr bytes_available = in_stream_peek_ptr(stream, &bytes);
+    if (bytes_available >= VARINT_MAX_SIZE) {
+        // Whole varint is in buffer, decode it in place
+        uptr size = 0;
+        for (u32 shift = 0; size < VARINT_MAX_SIZE; shift += 7) {
+            u8 byte = bytes[size++];
+            decoded |= (u64)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                // Last byte can hold only single bit of u64
+                result = size < VARINT_MAX_SIZE || byte <= 1;
+                break;
+            }
+        }
+        if (result) {
+            in_stream_advance(stream, size);
+        }
+    } else {
+        for (u32 shift = 0; shift < VARINT_MAX_SIZE * 7; shift += 7) {
+            u8 byte;
+            if (!serialization_read(stream, &byte, sizeof(byte))) {
+                break;
+            }
+            decoded |= (u64)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                result = shift < (VARINT_MAX_SIZE - 1) * 7 || byte <= 1;
+                break;
+            }
+        }
+    }
+    *value = result ? decoded : 0;
+    return result;
+}
+
+bool
+in_stream_read_zigzag(InStream *stream, i64 *value) {
+    u64 bits;
+    bool result = in_stream_read_varint(stream, &bits);
+    *value = zigzag_decode(bits);
+    return result;
+}
+
+bool
+in_stream_read_array(InStream *stream, void *out, uptr elem_size, uptr count) {
+    assert(elem_size == 1 || elem_size == 2 || elem_size == 4 || elem_size == 8);
+    uptr size = elem_size * count;
+    bool result = in_stream_read(stream, out, size) == size;
+    if (!result) {
+        mem_zero(out, size);
+    }
+#if SERIALIZATION_BIG_ENDIAN_HOST
+    u8 *cursor = out;
+    for (uptr elem_idx = 0; result && elem_idx < count; ++elem_idx, cursor += elem_size) {
+        if (elem_size == 2) {
+            u16 elem;
+            mem_copy(&elem, cursor, sizeof(elem));
+            elem = le16(elem);
+            mem_copy(cursor, &elem, sizeof(elem));
+        } else if (elem_size == 4) {
+            u32 elem;
+            mem_copy(&elem, cursor, sizeof(elem));
+            elem = le32(elem);
+            mem_copy(cursor, &elem, sizeof(elem));
+        } else if (elem_size == 8) {
+            u64 elem;
+            mem_copy(&elem, cursor, sizeof(elem));
+            elem = le64(elem);
+            mem_copy(cursor, &elem, sizeof(elem));
+        }
+    }
+#endif
+    return result;
+}
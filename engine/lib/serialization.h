@@ -0,0 +1,60 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: engine/lib/serialization.h
+// Version: 0
+//
+// Binary serialization on top of streams.
+// All values are stored in little-endian byte order regardless of host, so files written on one
+// machine can be read on any other.
+// Integers can also be stored as LEB128 varints, where each byte holds 7 bits of value and high bit
+// tells if there are more bytes. Small values then take 1-2 bytes instead of 8. Signed values are
+// zig-zag encoded first (0, -1, 1, -2 ... map to 0, 1, 2, 3 ...), so small negative values are small too.
+//
+// Writers return false if not whole value was written, which happens when buffer stream runs out of
+// space. Part of value that fit is still written in that case.
+// Readers are bounds-checked: they return false if stream ends before value is complete or if data
+// is malformed, and value is set to 0 in that case. Reading never goes past end of stream.
+#pragma once
+#include "lib/general.h"
+#include "stream.h"
+
+// Maximum number of bytes in LEB128 encoding of u64
+#define VARINT_MAX_SIZE 10
+
+u64 zigzag_encode(i64 value);
+i64 zigzag_decode(u64 value);
+
+// Fixed-width little-endian values
+bool out_stream_write_u8(OutStream *stream, u8 value);
+bool out_stream_write_u16(OutStream *stream, u16 value);
+bool out_stream_write_u32(OutStream *stream, u32 value);
+bool out_stream_write_u64(OutStream *stream, u64 value);
+bool out_stream_write_i8(OutStream *stream, i8 value);
+bool out_stream_write_i16(OutStream *stream, i16 value);
+bool out_stream_write_i32(OutStream *stream, i32 value);
+bool out_stream_write_i64(OutStream *stream, i64 value);
+bool out_stream_write_f32(OutStream *stream, f32 value);
+bool out_stream_write_f64(OutStream *stream, f64 value);
+// LEB128
+bool out_stream_write_varint(OutStream *stream, u64 value);
+// Zig-zag encoded LEB128
+bool out_stream_write_zigzag(OutStream *stream, i64 value);
+// Write count elements of elem_size bytes each (1, 2, 4 or 8) in little-endian.
+// On little-endian hosts array is written as single block, so big arrays bypass stream buffer
+bool out_stream_write_array(OutStream *stream, const void *data, uptr elem_size, uptr count);
+
+bool in_stream_read_u8(InStream *stream, u8 *value);
+bool in_stream_read_u16(InStream *stream, u16 *value);
+bool in_stream_read_u32(InStream *stream, u32 *value);
+bool in_stream_read_u64(InStream *stream, u64 *value);
+bool in_stream_read_i8(InStream *stream, i8 *value);
+bool in_stream_read_i16(InStream *stream, i16 *value);
+bool in_stream_read_i32(InStream *stream, i32 *value);
+bool in_stream_read_i64(InStream *stream, i64 *value);
+bool in_stream_read_f32(InStream *stream, f32 *value);
+bool in_stream_read_f64(InStream *stream, f64 *value);
+// Fails on encodings longer than VARINT_MAX_SIZE or not fitting in 64 bits
+bool in_stream_read_varint(InStream *stream, u64 *value);
+bool in_stream_read_zigzag(InStream *stream, i64 *value);
+// Read count elements of elem_size bytes each. Returns false if stream ended before whole array was read
+bool in_stream_read_array(InStream *stream, void *out, uptr elem_size, uptr count);
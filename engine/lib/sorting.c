@@ -1,41 +1,989 @@
 #include "sorting.h"
+#include "memory.h"
+#include "work_queue.h"
 
-u64 f32_to_sort_key(f32 value) {
-    u32 result = *(u32 *)&value;
+#include <string.h> // memcpy
+
+#define RADIX_DIGIT_BITS 8
+#define RADIX_BUCKET_COUNT (1 << RADIX_DIGIT_BITS)
+#define RADIX_DIGIT_MASK (RADIX_BUCKET_COUNT - 1)
+// 32-bit keys are sorted in 3 passes with 11-bit digits instead of 4 with 8-bit ones.
+// Scattering to 2048 places at once thrashes cache and TLB more, so saved pass only pays off when 
+// array is much bigger than cache and passes over memory dominate
+#define RADIX_WIDE_DIGIT_BITS 11
+#define RADIX_WIDE_BUCKET_COUNT (1 << RADIX_WIDE_DIGIT_BITS)
+#define RADIX_WIDE_DIGIT_MASK (RADIX_WIDE_BUCKET_COUNT - 1)
+#define RADIX_WIDE_DIGIT_MIN_COUNT (1 << 20)
+
+u32 
+f32_to_sort_key(f32 value) {
+    u32 result;
+    mem_copy(&result, &value, sizeof(result));
     if (result & 0x80000000) {
         result = ~result;
     } else {
         result |= 0x80000000;
     }
-    return (u64)result;
+    return result;
+}
+
+u64 
+f64_to_sort_key(f64 value) {
+    u64 result;
+    mem_copy(&result, &value, sizeof(result));
+    if (result & 0x8000000000000000llu) {
+        result = ~result;
+    } else {
+        result |= 0x8000000000000000llu;
+    }
+    return result;
+}
+
+// Turns histogram into offsets. 
+// Returns false if all keys fall in the same bucket - then pass on this digit does not change order
+static bool 
+radix_histogram_to_offsets(u32 *histogram, u32 bucket_count, uptr n) {
+    bool result = true;
+    u32 total = 0;
+    for (u32 bucket = 0; bucket < bucket_count; ++bucket) {
+        u32 count = histogram[bucket];
+        if (count == n) {
+            result = false;
+            break;
+        }
+        histogram[bucket] = total;
+        total += count;
+    }
+    return result;
+}
+
+void 
+radix_sort64(SortEntry64 *entries, SortEntry64 *sort_temp, uptr n) {
+    assert(n <= 0xFFFFFFFF);
+    u32 histograms[64 / RADIX_DIGIT_BITS][RADIX_BUCKET_COUNT] = {};
+    for (uptr i = 0; i < n; ++i) {
+        u64 key = entries[i].key;
+        for (u32 digit = 0; digit < ARRAY_SIZE(histograms); ++digit) {
+            ++histograms[digit][(key >> (digit * RADIX_DIGIT_BITS)) & RADIX_DIGIT_MASK];
+        }
+    }
+    
+    SortEntry64 *src = entries;
+    SortEntry64 *dst = sort_temp;
+    for (u32 digit = 0; digit < ARRAY_SIZE(histograms); ++digit) {
+        u32 *offsets = histograms[digit];
+        if (radix_histogram_to_offsets(offsets, RADIX_BUCKET_COUNT, n)) {
+            u32 shift = digit * RADIX_DIGIT_BITS;
+            for (uptr i = 0; i < n; ++i) {
+                SortEntry64 entry = src[i];
+                dst[offsets[(entry.key >> shift) & RADIX_DIGIT_MASK]++] = entry;
+            }
+            
+            SortEntry64 *temp = dst;
+            dst = src;
+            src = temp;
+        }
+    }
+    
+    // Skipped passes can leave result in temp
+    if (src != entries) {
+        mem_copy(entries, src, n * sizeof(SortEntry64));
+    }
+}
+
+void 
+radix_sort_keys64(u64 *keys, u32 *values, u64 *keys_temp, u32 *values_temp, uptr n) {
+    assert(n <= 0xFFFFFFFF);
+    u32 histograms[64 / RADIX_DIGIT_BITS][RADIX_BUCKET_COUNT] = {};
+    for (uptr i = 0; i < n; ++i) {
+        u64 key = keys[i];
+        for (u32 digit = 0; digit < ARRAY_SIZE(histograms); ++digit) {
+            ++histograms[digit][(key >> (digit * RADIX_DIGIT_BITS)) & RADIX_DIGIT_MASK];
+        }
+    }
+    
+    u64 *src_keys = keys;
+    u64 *dst_keys = keys_temp;
+    u32 *src_values = values;
+    u32 *dst_values = values_temp;
+    for (u32 digit = 0; digit < ARRAY_SIZE(histograms); ++digit) {
+        u32 *offsets = histograms[digit];
+        if (radix_histogram_to_offsets(offsets, RADIX_BUCKET_COUNT, n)) {
+            u32 shift = digit * RADIX_DIGIT_BITS;
+            for (uptr i = 0; i < n; ++i) {
+                u64 key = src_keys[i];
+                u32 dst_idx = offsets[(key >> shift) & RADIX_DIGIT_MASK]++;
+                dst_keys[dst_idx] = key;
+                dst_values[dst_idx] = src_values[i];
+            }
+            
+            u64 *temp_keys = dst_keys;
+            dst_keys = src_keys;
+            src_keys = temp_keys;
+            u32 *temp_values = dst_values;
+            dst_values = src_values;
+            src_values = temp_values;
+        }
+    }
+    
+    if (src_keys != keys) {
+        mem_copy(keys, src_keys, n * sizeof(u64));
+        mem_copy(values, src_values, n * sizeof(u32));
+    }
+}
+
+static void 
+radix_sort_narrow(SortEntry *entries, SortEntry *sort_temp, uptr n) {
+    u32 histograms[32 / RADIX_DIGIT_BITS][RADIX_BUCKET_COUNT] = {};
+    for (uptr i = 0; i < n; ++i) {
+        u32 key = entries[i].key;
+        ++histograms[0][key & RADIX_DIGIT_MASK];
+        ++histograms[1][(key >> 8) & RADIX_DIGIT_MASK];
+        ++histograms[2][(key >> 16) & RADIX_DIGIT_MASK];
+        ++histograms[3][key >> 24];
+    }
+    
+    SortEntry *src = entries;
+    SortEntry *dst = sort_temp;
+    for (u32 digit = 0; digit < ARRAY_SIZE(histograms); ++digit) {
+        u32 *offsets = histograms[digit];
+        if (radix_histogram_to_offsets(offsets, RADIX_BUCKET_COUNT, n)) {
+            u32 shift = digit * RADIX_DIGIT_BITS;
+            for (uptr i = 0; i < n; ++i) {
+                SortEntry entry = src[i];
+                dst[offsets[(entry.key >> shift) & RADIX_DIGIT_MASK]++] = entry;
+            }
+            
+            SortEntry *temp = dst;
+            dst = src;
+            src = temp;
+        }
+    }
+    
+    if (src != entries) {
+        mem_copy(entries, src, n * sizeof(SortEntry));
+    }
+}
+
+static void 
+radix_sort_wide(SortEntry *entries, SortEntry *sort_temp, uptr n) {
+    u32 histograms[3][RADIX_WIDE_BUCKET_COUNT] = {};
+    for (uptr i = 0; i < n; ++i) {
+        u32 key = entries[i].key;
+        ++histograms[0][key & RADIX_WIDE_DIGIT_MASK];
+        ++histograms[1][(key >> 11) & RADIX_WIDE_DIGIT_MASK];
+        ++histograms[2][key >> 22];
+    }
+    
+    SortEntry *src = entries;
+    SortEntry *dst = sort_temp;
+    for (u32 digit = 0; digit < ARRAY_SIZE(histograms); ++digit) {
+        u32 *offsets = histograms[digit];
+        if (radix_histogram_to_offsets(offsets, RADIX_WIDE_BUCKET_COUNT, n)) {
+            u32 shift = digit * RADIX_WIDE_DIGIT_BITS;
+            for (uptr i = 0; i < n; ++i) {
+                SortEntry entry = src[i];
+                dst[offsets[(entry.key >> shift) & RADIX_WIDE_DIGIT_MASK]++] = entry;
+            }
+            
+            SortEntry *temp = dst;
+            dst = src;
+            src = temp;
+        }
+    }
+    
+    if (src != entries) {
+        mem_copy(entries, src, n * sizeof(SortEntry));
+    }
+}
+
+void 
+radix_sort(SortEntry *entries, SortEntry *sort_temp, uptr n) {
+    assert(n <= 0xFFFFFFFF);
+    if (n >= RADIX_WIDE_DIGIT_MIN_COUNT) {
+        radix_sort_wide(entries, sort_temp, n);
+    } else {
+        radix_sort_narrow(entries, sort_temp, n);
+    }
+}
+
+// Arrays smaller than this are sorted on single thread
+#define RADIX_SORT_PARALLEL_MIN_COUNT (1 << 16)
+
+typedef struct {
+    SortEntry *src;
+    SortEntry *dst;
+    uptr start;
+    uptr end;
+    u32 shift;
+    // Histograms of part for all digits. Before scatter, histogram of current digit is turned into 
+    // offsets where part writes its elements
+    u32 histograms[32 / RADIX_DIGIT_BITS][RADIX_BUCKET_COUNT];
+} Radix_Sort_Part;
+
+static WORK_QUEUE_CALLBACK(radix_sort_count_all_digits) {
+    Radix_Sort_Part *part = data;
+    mem_zero(part->histograms, sizeof(part->histograms));
+    for (uptr i = part->start; i < part->end; ++i) {
+        u32 key = part->src[i].key;
+        ++part->histograms[0][key & RADIX_DIGIT_MASK];
+        ++part->histograms[1][(key >> 8) & RADIX_DIGIT_MASK];
+        ++part->histograms[2][(key >> 16) & RADIX_DIGIT_MASK];
+        ++part->histograms[3][key >> 24];
+    }
+}
+
+static WORK_QUEUE_CALLBACK(radix_sort_count_digit) {
+    Radix_Sort_Part *part = data;
+    u32 *histogram = part->histograms[part->shift / RADIX_DIGIT_BITS];
+    mem_zero(histogram, RADIX_BUCKET_COUNT * sizeof(u32));
+    for (uptr i = part->start; i < part->end; ++i) {
+        ++histogram[(part->src[i].key >> part->shift) & RADIX_DIGIT_MASK];
+    }
+}
+
+static WORK_QUEUE_CALLBACK(radix_sort_scatter) {
+    Radix_Sort_Part *part = data;
+    u32 *offsets = part->histograms[part->shift / RADIX_DIGIT_BITS];
+    for (uptr i = part->start; i < part->end; ++i) {
+        SortEntry entry = part->src[i];
+        part->dst[offsets[(entry.key >> part->shift) & RADIX_DIGIT_MASK]++] = entry;
+    }
 }
 
-void radix_sort(SortEntry *entries, SortEntry *sort_temp, uptr n) {
+void 
+radix_sort_parallel(Work_Queue *queue, SortEntry *entries, SortEntry *sort_temp, uptr n) {
+    assert(n <= 0xFFFFFFFF);
+    u32 part_count = work_queue_parallelism(queue);
+    if (n < RADIX_SORT_PARALLEL_MIN_COUNT || part_count == 1) {
+        radix_sort(entries, sort_temp, n);
+        return;
+    }
+    
+    Radix_Sort_Part *parts = mem_alloc(part_count * sizeof(Radix_Sort_Part));
+    uptr part_size = (n + part_count - 1) / part_count;
+    for (u32 part_idx = 0; part_idx < part_count; ++part_idx) {
+        Radix_Sort_Part *part = parts + part_idx;
+        part->start = part_idx * part_size;
+        part->end = part->start + part_size;
+        if (part->end > n) {
+            part->end = n;
+        }
+        if (part->start > n) {
+            part->start = n;
+        }
+        part->src = entries;
+        work_queue_add(queue, radix_sort_count_all_digits, part);
+    }
+    work_queue_complete_all(queue);
+    
+    // Total histograms tell which digits can be skipped
+    u32 totals[32 / RADIX_DIGIT_BITS][RADIX_BUCKET_COUNT] = {};
+    for (u32 part_idx = 0; part_idx < part_count; ++part_idx) {
+        for (u32 digit = 0; digit < ARRAY_SIZE(totals); ++digit) {
+            for (u32 bucket = 0; bucket < RADIX_BUCKET_COUNT; ++bucket) {
+                totals[digit][bucket] += parts[part_idx].histograms[digit][bucket];
+            }
+        }
+    }
+    
     SortEntry *src = entries;
     SortEntry *dst = sort_temp;
-    for (u32 byte_idx = 0; byte_idx < 32; byte_idx += 8) {
-        u32 sort_key_offsets[256] = {};
-        for (u32 i = 0; i < n; ++i) {
-            u32 radix_value = src[i].key;
-            u32 radix_piece = (radix_value >> byte_idx) & 0xFF;
-            ++sort_key_offsets[radix_piece];
+    bool is_original_order = true;
+    for (u32 digit = 0; digit < ARRAY_SIZE(totals); ++digit) {
+        if (!radix_histogram_to_offsets(totals[digit], RADIX_BUCKET_COUNT, n)) {
+            continue;
+        }
+        
+        u32 shift = digit * RADIX_DIGIT_BITS;
+        // Histograms collected before sorting are only valid for original order
+        if (!is_original_order) {
+            for (u32 part_idx = 0; part_idx < part_count; ++part_idx) {
+                Radix_Sort_Part *part = parts + part_idx;
+                part->src = src;
+                part->shift = shift;
+                work_queue_add(queue, radix_sort_count_digit, part);
+            }
+            work_queue_complete_all(queue);
         }
         
-        u32 total = 0;
-        for (u32 sort_key_idx = 0; sort_key_idx < ARRAY_SIZE(sort_key_offsets); ++sort_key_idx) {
-            u32 count = sort_key_offsets[sort_key_idx];
-            sort_key_offsets[sort_key_idx] = total;
-            total += count;
+        // Elements of bucket from earlier parts go first, so sort stays stable
+        for (u32 bucket = 0; bucket < RADIX_BUCKET_COUNT; ++bucket) {
+            u32 offset = totals[digit][bucket];
+            for (u32 part_idx = 0; part_idx < part_count; ++part_idx) {
+                u32 *histogram = parts[part_idx].histograms[digit];
+                u32 count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += count;
+            }
         }
         
-        for (u32 i = 0; i < n; ++i) {
-            u32 radix_value = src[i].key;
-            u32 radix_piece = (radix_value >> byte_idx) & 0xFF;
-            dst[sort_key_offsets[radix_piece]++] = src[i];
+        for (u32 part_idx = 0; part_idx < part_count; ++part_idx) {
+            Radix_Sort_Part *part = parts + part_idx;
+            part->src = src;
+            part->dst = dst;
+            part->shift = shift;
+            work_queue_add(queue, radix_sort_scatter, part);
         }
+        work_queue_complete_all(queue);
+        is_original_order = false;
         
         SortEntry *temp = dst;
         dst = src;
         src = temp;
     }
-}
\ No newline at end of file
+    
+    if (src != entries) {
+        mem_copy(entries, src, n * sizeof(SortEntry));
+    }
+    mem_free(parts, part_count * sizeof(Radix_Sort_Part));
+}
+
+// Ranges of this size and smaller are sorted with insertion sort
+#define SORT_INSERTION_THRESHOLD 16
+// Ranges bigger than this take pivot as median of 3 medians of 3
+#define SORT_NINTHER_THRESHOLD 128
+// Partial insertion sort gives up after this number of moved elements
+#define SORT_PARTIAL_INSERTION_LIMIT 8
+
+typedef struct {
+    u8 *base;
+    uptr stride;
+    Sort_Compare_Func *cmp;
+    void *user_data;
+} Sort_Ctx;
+
+static u8 *
+sort_at(Sort_Ctx *ctx, uptr idx) {
+    return ctx->base + idx * ctx->stride;
+}
+
+static bool 
+sort_less(Sort_Ctx *ctx, uptr a, uptr b) {
+    return ctx->cmp(sort_at(ctx, a), sort_at(ctx, b), ctx->user_data) < 0;
+}
+
+static void 
+sort_swap(Sort_Ctx *ctx, uptr a, uptr b) {
+    u8 *pa = sort_at(ctx, a);
+    u8 *pb = sort_at(ctx, b);
+    uptr size = ctx->stride;
+    // Common sizes of pointers and indices are swapped with constant-sized copies, which compile to moves
+    if (size == sizeof(u64)) {
+        u64 temp;
+        memcpy(&temp, pa, sizeof(temp));
+        memcpy(pa, pb, sizeof(temp));
+        memcpy(pb, &temp, sizeof(temp));
+        return;
+    } else if (size == sizeof(u32)) {
+        u32 temp;
+        memcpy(&temp, pa, sizeof(temp));
+        memcpy(pa, pb, sizeof(temp));
+        memcpy(pb, &temp, sizeof(temp));
+        return;
+    }
+    
+    u8 temp[64];
+    while (size) {
+        uptr chunk = size < sizeof(temp) ? size : sizeof(temp);
+        memcpy(temp, pa, chunk);
+        memcpy(pa, pb, chunk);
+        memcpy(pb, temp, chunk);
+        pa += chunk;
+        pb += chunk;
+        size -= chunk;
+    }
+}
+
+static void 
+sort_insertion(Sort_Ctx *ctx, uptr lo, uptr hi) {
+    for (uptr i = lo + 1; i < hi; ++i) {
+        for (uptr j = i; j > lo && sort_less(ctx, j, j - 1); --j) {
+            sort_swap(ctx, j, j - 1);
+        }
+    }
+}
+
+// Returns false if range turned out to need too many moves, leaving it partially sorted
+static bool 
+sort_partial_insertion(Sort_Ctx *ctx, uptr lo, uptr hi) {
+    u32 moves = 0;
+    for (uptr i = lo + 1; i < hi; ++i) {
+        for (uptr j = i; j > lo && sort_less(ctx, j, j - 1); --j) {
+            sort_swap(ctx, j, j - 1);
+            if (++moves > SORT_PARTIAL_INSERTION_LIMIT) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void 
+sort_sift_down(Sort_Ctx *ctx, uptr lo, uptr root, uptr count) {
+    for (;;) {
+        uptr child = 2 * root + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && sort_less(ctx, lo + child, lo + child + 1)) {
+            ++child;
+        }
+        if (!sort_less(ctx, lo + root, lo + child)) {
+            break;
+        }
+        sort_swap(ctx, lo + root, lo + child);
+        root = child;
+    }
+}
+
+static void 
+sort_heapsort(Sort_Ctx *ctx, uptr lo, uptr hi) {
+    uptr count = hi - lo;
+    for (uptr i = count / 2; i-- > 0;) {
+        sort_sift_down(ctx, lo, i, count);
+    }
+    for (uptr i = count - 1; i > 0; --i) {
+        sort_swap(ctx, lo, lo + i);
+        sort_sift_down(ctx, lo, 0, i);
+    }
+}
+
+static void 
+sort_median3(Sort_Ctx *ctx, uptr a, uptr b, uptr c) {
+    // Orders elements so median ends up in b
+    if (sort_less(ctx, b, a)) {
+        sort_swap(ctx, a, b);
+    }
+    if (sort_less(ctx, c, b)) {
+        sort_swap(ctx, b, c);
+        if (sort_less(ctx, b, a)) {
+            sort_swap(ctx, a, b);
+        }
+    }
+}
+
+// Moves pivot to lo
+static void 
+sort_choose_pivot(Sort_Ctx *ctx, uptr lo, uptr hi) {
+    uptr count = hi - lo;
+    uptr mid = lo + count / 2;
+    if (count > SORT_NINTHER_THRESHOLD) {
+        uptr step = count / 8;
+        sort_median3(ctx, lo, lo + step, lo + 2 * step);
+        sort_median3(ctx, mid - step, mid, mid + step);
+        sort_median3(ctx, hi - 1 - 2 * step, hi - 1 - step, hi - 1);
+        sort_median3(ctx, lo + step, mid, hi - 1 - step);
+    } else {
+        sort_median3(ctx, lo, mid, hi - 1);
+    }
+    sort_swap(ctx, lo, mid);
+}
+
+// Partitions range around pivot at lo. Elements equal to pivot stop scans from both sides, 
+// so arrays with many equal elements are split evenly.
+// Returns final position of pivot
+static uptr 
+sort_partition(Sort_Ctx *ctx, uptr lo, uptr hi, bool *was_partitioned) {
+    uptr i = lo + 1;
+    uptr j = hi - 1;
+    bool did_swap = false;
+    for (;;) {
+        while (i <= j && sort_less(ctx, i, lo)) {
+            ++i;
+        }
+        while (i <= j && sort_less(ctx, lo, j)) {
+            --j;
+        }
+        if (i >= j) {
+            break;
+        }
+        sort_swap(ctx, i, j);
+        did_swap = true;
+        ++i;
+        --j;
+    }
+    sort_swap(ctx, lo, j);
+    *was_partitioned = !did_swap;
+    return j;
+}
+
+static void 
+sort_introsort(Sort_Ctx *ctx, uptr lo, uptr hi, u32 bad_allowed) {
+    while (hi - lo > SORT_INSERTION_THRESHOLD) {
+        sort_choose_pivot(ctx, lo, hi);
+        bool was_partitioned;
+        uptr pivot = sort_partition(ctx, lo, hi, &was_partitioned);
+        uptr left_count = pivot - lo;
+        uptr right_count = hi - pivot - 1;
+        uptr count = hi - lo;
+        
+        bool is_unbalanced = left_count < count / 8 || right_count < count / 8;
+        if (is_unbalanced) {
+            // Too many bad pivots means input is adversarial, heapsort guarantees n log n
+            if (--bad_allowed == 0) {
+                sort_heapsort(ctx, lo, hi);
+                return;
+            }
+            // Break patterns that lead to bad pivots
+            if (left_count >= SORT_INSERTION_THRESHOLD) {
+                sort_swap(ctx, lo, lo + left_count / 4);
+                sort_swap(ctx, pivot - 1, pivot - left_count / 4);
+            }
+            if (right_count >= SORT_INSERTION_THRESHOLD) {
+                sort_swap(ctx, pivot + 1, pivot + 1 + right_count / 4);
+                sort_swap(ctx, hi - 1, hi - right_count / 4);
+            }
+        } else if (was_partitioned) {
+            // Range was probably already sorted - check it cheaply
+            if (sort_partial_insertion(ctx, lo, pivot) && sort_partial_insertion(ctx, pivot + 1, hi)) {
+                return;
+            }
+        }
+        
+        // Recurse into smaller part, so stack depth is logarithmic
+        if (left_count < right_count) {
+            sort_introsort(ctx, lo, pivot, bad_allowed);
+            lo = pivot + 1;
+        } else {
+            sort_introsort(ctx, pivot + 1, hi, bad_allowed);
+            hi = pivot;
+        }
+    }
+    sort_insertion(ctx, lo, hi);
+}
+
+static u32 
+sort_log2(uptr count) {
+    u32 result = 0;
+    while (count >>= 1) {
+        ++result;
+    }
+    return result;
+}
+
+void 
+comparison_sort(void *base, uptr count, uptr stride, Sort_Compare_Func *cmp, void *user_data) {
+    Sort_Ctx ctx = { (u8 *)base, stride, cmp, user_data };
+    if (count > 1) {
+        sort_introsort(&ctx, 0, count, sort_log2(count) + 1);
+    }
+}
+
+void 
+stable_sort(void *base, uptr count, uptr stride, Sort_Compare_Func *cmp, void *user_data, void *temp) {
+    Sort_Ctx ctx = { (u8 *)base, stride, cmp, user_data };
+    // Insertion sort only moves elements past strictly greater ones, so it is stable
+    for (uptr lo = 0; lo < count; lo += SORT_INSERTION_THRESHOLD) {
+        uptr hi = lo + SORT_INSERTION_THRESHOLD;
+        sort_insertion(&ctx, lo, hi < count ? hi : count);
+    }
+    
+    u8 *src = base;
+    u8 *dst = temp;
+    for (uptr width = SORT_INSERTION_THRESHOLD; width < count; width *= 2) {
+        for (uptr lo = 0; lo < count; lo += 2 * width) {
+            uptr mid = lo + width < count ? lo + width : count;
+            uptr hi = lo + 2 * width < count ? lo + 2 * width : count;
+            uptr left = lo;
+            uptr right = mid;
+            u8 *out = dst + lo * stride;
+            // Runs that are already in order are copied as is
+            if (mid == hi || cmp(src + mid * stride, src + (mid - 1) * stride, user_data) >= 0) {
+                memcpy(out, src + lo * stride, (hi - lo) * stride);
+                continue;
+            }
+            
+            while (left < mid && right < hi) {
+                // Element from left run goes first if elements are equal
+                if (cmp(src + right * stride, src + left * stride, user_data) < 0) {
+                    memcpy(out, src + right++ * stride, stride);
+                } else {
+                    memcpy(out, src + left++ * stride, stride);
+                }
+                out += stride;
+            }
+            memcpy(out, src + left * stride, (mid - left) * stride);
+            out += (mid - left) * stride;
+            memcpy(out, src + right * stride, (hi - right) * stride);
+        }
+        u8 *swap_temp = src;
+        src = dst;
+        dst = swap_temp;
+    }
+    
+    if (src != base) {
+        memcpy(base, src, count * stride);
+    }
+}
+
+static void 
+sort_select(Sort_Ctx *ctx, uptr lo, uptr hi, uptr nth) {
+    u32 bad_allowed = sort_log2(hi - lo) + 1;
+    while (hi - lo > SORT_INSERTION_THRESHOLD) {
+        sort_choose_pivot(ctx, lo, hi);
+        bool was_partitioned;
+        uptr pivot = sort_partition(ctx, lo, hi, &was_partitioned);
+        uptr count = hi - lo;
+        if (pivot - lo < count / 8 || hi - pivot - 1 < count / 8) {
+            if (--bad_allowed == 0) {
+                sort_heapsort(ctx, lo, hi);
+                return;
+            }
+        }
+        
+        if (pivot == nth) {
+            return;
+        } else if (nth < pivot) {
+            hi = pivot;
+        } else {
+            lo = pivot + 1;
+        }
+    }
+    sort_insertion(ctx, lo, hi);
+}
+
+void 
+select_nth(void *base, uptr count, uptr stride, uptr nth, Sort_Compare_Func *cmp, void *user_data) {
+    Sort_Ctx ctx = { (u8 *)base, stride, cmp, user_data };
+    if (nth < count) {
+        sort_select(&ctx, 0, count, nth);
+    }
+}
+
+void 
+partial_sort(void *base, uptr count, uptr stride, uptr k, Sort_Compare_Func *cmp, void *user_data) {
+    Sort_Ctx ctx = { (u8 *)base, stride, cmp, user_data };
+    if (k > count) {
+        k = count;
+    }
+    if (k < count) {
+        sort_select(&ctx, 0, count, k);
+    }
+    if (k > 1) {
+        sort_introsort(&ctx, 0, k, sort_log2(k) + 1);
+    }
+}
+
+// SortEntry versions of algorithms above. Keys are compared directly, so there is no call per comparison
+static void 
+entries_swap(SortEntry *entries, uptr a, uptr b) {
+    SortEntry temp = entries[a];
+    entries[a] = entries[b];
+    entries[b] = temp;
+}
+
+static void 
+entries_insertion(SortEntry *entries, uptr lo, uptr hi) {
+    for (uptr i = lo + 1; i < hi; ++i) {
+        SortEntry entry = entries[i];
+        uptr j = i;
+        while (j > lo && entry.key < entries[j - 1].key) {
+            entries[j] = entries[j - 1];
+            --j;
+        }
+        entries[j] = entry;
+    }
+}
+
+static bool 
+entries_partial_insertion(SortEntry *entries, uptr lo, uptr hi) {
+    u32 moves = 0;
+    for (uptr i = lo + 1; i < hi; ++i) {
+        SortEntry entry = entries[i];
+        uptr j = i;
+        while (j > lo && entry.key < entries[j - 1].key) {
+            entries[j] = entries[j - 1];
+            --j;
+        }
+        entries[j] = entry;
+        moves += (u32)(i - j);
+        if (moves > SORT_PARTIAL_INSERTION_LIMIT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void 
+entries_sift_down(SortEntry *heap, uptr root, uptr count) {
+    for (;;) {
+        uptr child = 2 * root + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && heap[child].key < heap[child + 1].key) {
+            ++child;
+        }
+        if (!(heap[root].key < heap[child].key)) {
+            break;
+        }
+        entries_swap(heap, root, child);
+        root = child;
+    }
+}
+
+static void 
+entries_heapsort(SortEntry *entries, uptr lo, uptr hi) {
+    SortEntry *heap = entries + lo;
+    uptr count = hi - lo;
+    for (uptr i = count / 2; i-- > 0;) {
+        entries_sift_down(heap, i, count);
+    }
+    for (uptr i = count - 1; i > 0; --i) {
+        entries_swap(heap, 0, i);
+        entries_sift_down(heap, 0, i);
+    }
+}
+
+static void 
+entries_median3(SortEntry *entries, uptr a, uptr b, uptr c) {
+    if (entries[b].key < entries[a].key) {
+        entries_swap(entries, a, b);
+    }
+    if (entries[c].key < entries[b].key) {
+        entries_swap(entries, b, c);
+        if (entries[b].key < entries[a].key) {
+            entries_swap(entries, a, b);
+        }
+    }
+}
+
+static void 
+entries_choose_pivot(SortEntry *entries, uptr lo, uptr hi) {
+    uptr count = hi - lo;
+    uptr mid = lo + count / 2;
+    if (count > SORT_NINTHER_THRESHOLD) {
+        uptr step = count / 8;
+        entries_median3(entries, lo, lo + step, lo + 2 * step);
+        entries_median3(entries, mid - step, mid, mid + step);
+        entries_median3(entries, hi - 1 - 2 * step, hi - 1 - step, hi - 1);
+        entries_median3(entries, lo + step, mid, hi - 1 - step);
+    } else {
+        entries_median3(entries, lo, mid, hi - 1);
+    }
+    entries_swap(entries, lo, mid);
+}
+
+static uptr 
+entries_partition(SortEntry *entries, uptr lo, uptr hi, bool *was_partitioned) {
+    u32 pivot_key = entries[lo].key;
+    uptr i = lo + 1;
+    uptr j = hi - 1;
+    bool did_swap = false;
+    for (;;) {
+        while (i <= j && entries[i].key < pivot_key) {
+            ++i;
+        }
+        while (i <= j && pivot_key < entries[j].key) {
+            --j;
+        }
+        if (i >= j) {
+            break;
+        }
+        entries_swap(entries, i, j);
+        did_swap = true;
+        ++i;
+        --j;
+    }
+    entries_swap(entries, lo, j);
+    *was_partitioned = !did_swap;
+    return j;
+}
+
+static void 
+entries_introsort(SortEntry *entries, uptr lo, uptr hi, u32 bad_allowed) {
+    while (hi - lo > SORT_INSERTION_THRESHOLD) {
+        entries_choose_pivot(entries, lo, hi);
+        bool was_partitioned;
+        uptr pivot = entries_partition(entries, lo, hi, &was_partitioned);
+        uptr left_count = pivot - lo;
+        uptr right_count = hi - pivot - 1;
+        uptr count = hi - lo;
+        
+        if (left_count < count / 8 || right_count < count / 8) {
+            if (--bad_allowed == 0) {
+                entries_heapsort(entries, lo, hi);
+                return;
+            }
+            if (left_count >= SORT_INSERTION_THRESHOLD) {
+                entries_swap(entries, lo, lo + left_count / 4);
+                entries_swap(entries, pivot - 1, pivot - left_count / 4);
+            }
+            if (right_count >= SORT_INSERTION_THRESHOLD) {
+                entries_swap(entries, pivot + 1, pivot + 1 + right_count / 4);
+                entries_swap(entries, hi - 1, hi - right_count / 4);
+            }
+        } else if (was_partitioned) {
+            if (entries_partial_insertion(entries, lo, pivot) && entries_partial_insertion(entries, pivot + 1, hi)) {
+                return;
+            }
+        }
+        
+        if (left_count < right_count) {
+            entries_introsort(entries, lo, pivot, bad_allowed);
+            lo = pivot + 1;
+        } else {
+            entries_introsort(entries, pivot + 1, hi, bad_allowed);
+            hi = pivot;
+        }
+    }
+    entries_insertion(entries, lo, hi);
+}
+
+static void 
+entries_select(SortEntry *entries, uptr lo, uptr hi, uptr nth) {
+    u32 bad_allowed = sort_log2(hi - lo) + 1;
+    while (hi - lo > SORT_INSERTION_THRESHOLD) {
+        entries_choose_pivot(entries, lo, hi);
+        bool was_partitioned;
+        uptr pivot = entries_partition(entries, lo, hi, &was_partitioned);
+        uptr count = hi - lo;
+        if (pivot - lo < count / 8 || hi - pivot - 1 < count / 8) {
+            if (--bad_allowed == 0) {
+                entries_heapsort(entries, lo, hi);
+                return;
+            }
+        }
+        
+        if (pivot == nth) {
+            return;
+        } else if (nth < pivot) {
+            hi = pivot;
+        } else {
+            lo = pivot + 1;
+        }
+    }
+    entries_insertion(entries, lo, hi);
+}
+
+void 
+sort_entries(SortEntry *entries, uptr n) {
+    if (n > 1) {
+        entries_introsort(entries, 0, n, sort_log2(n) + 1);
+    }
+}
+
+void 
+select_nth_entry(SortEntry *entries, uptr n, uptr nth) {
+    if (nth < n) {
+        entries_select(entries, 0, n, nth);
+    }
+}
+
+void 
+partial_sort_entries(SortEntry *entries, uptr n, uptr k) {
+    if (k > n) {
+        k = n;
+    }
+    if (k < n) {
+        entries_select(entries, 0, n, k);
+    }
+    if (k > 1) {
+        entries_introsort(entries, 0, k, sort_log2(k) + 1);
+    }
+}
+
+// Insertion sort is only tried if there are at most n / INCREMENTAL_SORT_INSERTION_DESCENT_DEN places 
+// where order breaks, and gives up after moving elements n / INCREMENTAL_SORT_INSERTION_MOVE_DEN times in total
+#define INCREMENTAL_SORT_INSERTION_DESCENT_DEN 64
+#define INCREMENTAL_SORT_INSERTION_MOVE_DEN 8
+// Moved out elements are sorted with radix sort if there are many of them
+#define INCREMENTAL_SORT_RADIX_MIN_COUNT 256
+// Number of elements moved out in a row after which last kept element is considered out of order
+#define INCREMENTAL_SORT_BACKTRACK_COUNT 8
+
+// Returns false if moves exceeded limit, array is partially sorted then
+static bool 
+entries_bounded_insertion(SortEntry *entries, uptr n, uptr move_limit) {
+    uptr moves = 0;
+    for (uptr i = 1; i < n; ++i) {
+        SortEntry entry = entries[i];
+        uptr j = i;
+        while (j > 0 && entry.key < entries[j - 1].key) {
+            entries[j] = entries[j - 1];
+            --j;
+        }
+        entries[j] = entry;
+        moves += i - j;
+        if (moves > move_limit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Incremental_Sort_Path 
+incremental_sort(SortEntry *entries, SortEntry *temp, uptr n) {
+    uptr descent_count = 0;
+    for (uptr i = 1; i < n; ++i) {
+        descent_count += entries[i].key < entries[i - 1].key;
+    }
+    if (descent_count == 0) {
+        return INCREMENTAL_SORT_ALREADY_SORTED;
+    }
+    
+    if (descent_count <= n / INCREMENTAL_SORT_INSERTION_DESCENT_DEN && 
+        entries_bounded_insertion(entries, n, n / INCREMENTAL_SORT_INSERTION_MOVE_DEN)) {
+        return INCREMENTAL_SORT_INSERTION;
+    }
+    
+    // Elements are moved out with drop-merge heuristics: element is kept if it is not less than last 
+    // kept one. Otherwise either it or last kept element is moved out, depending on which of them 
+    // looks like it has changed key. If too many elements are moved out in a row, last kept element 
+    // was probably the changed one, so it is moved out and elements after it are looked at again
+    uptr max_moved = n / INCREMENTAL_SORT_MAX_CHURN_DEN;
+    uptr kept = 0;
+    uptr moved = 0;
+    uptr moved_in_row = 0;
+    for (uptr i = 0; i < n; ++i) {
+        SortEntry entry = entries[i];
+        if (kept == 0 || entries[kept - 1].key <= entry.key) {
+            entries[kept++] = entry;
+            moved_in_row = 0;
+            continue;
+        }
+        
+        if (moved_in_row >= INCREMENTAL_SORT_BACKTRACK_COUNT) {
+            // Elements moved out in a row are still in place, because nothing was kept after them
+            i -= moved_in_row + 1;
+            moved -= moved_in_row;
+            moved_in_row = 0;
+            temp[moved++] = entries[--kept];
+        } else if (kept >= 2 && entries[kept - 2].key <= entry.key) {
+            temp[moved++] = entries[kept - 1];
+            entries[kept - 1] = entry;
+            moved_in_row = 0;
+        } else {
+            temp[moved++] = entry;
+            ++moved_in_row;
+        }
+        
+        if (moved > max_moved) {
+            // Put moved out elements back, so array is whole, and sort everything
+            mem_copy(entries + kept, temp, moved * sizeof(SortEntry));
+            radix_sort(entries, temp, n);
+            return INCREMENTAL_SORT_RADIX;
+        }
+    }
+    
+    // Churn limit is at most half of array, so rest of temp is enough for sorting moved out elements
+    if (moved >= INCREMENTAL_SORT_RADIX_MIN_COUNT) {
+        radix_sort(temp, temp + moved, moved);
+    } else {
+        sort_entries(temp, moved);
+    }
+    
+    // Merge from the end, so kept elements are not overwritten before they are read
+    uptr out = n;
+    uptr kept_idx = kept;
+    uptr moved_idx = moved;
+    while (moved_idx > 0) {
+        if (kept_idx > 0 && temp[moved_idx - 1].key < entries[kept_idx - 1].key) {
+            entries[--out] = entries[--kept_idx];
+        } else {
+            entries[--out] = temp[--moved_idx];
+        }
+    }
+    return INCREMENTAL_SORT_MERGE;
+}
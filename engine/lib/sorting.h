@@ -7,17 +7,89 @@
 #pragma once
 #include "lib/general.h"
 
+struct Work_Queue;
+
 // Implementation of radix sort.
 // Has limitation of only operating on numerical values - so all sort entries have to be represented as numbers.
-// Using radix sort can become too verbose in some string-heavy places, so another sorting algorithm may be introduced
+// Using radix sort can become too verbose in some string-heavy places, so comparison sorts are provided too (see below)
 
 typedef struct SortEntry {
     u32 key;   // value that array needs to be sorted around. Floating-point needs special handling, see functions below
     u32 value; // any value that user can use to use sort data
 } SortEntry;
-// Construct soring key from floating-pointvalue
-u32 f64_to_sort_key(f64 value);
+
+// Entry with 64-bit key, used when key is composed from several fields
+// (for example layer, pipeline, material and depth of render command)
+typedef struct SortEntry64 {
+    u64 key;
+    u64 value;
+} SortEntry64;
+
+// Construct soring key from floating-point value. 
+// Keys of negative values are ordered before positive ones, so sorting keys sorts values
+u32 f32_to_sort_key(f32 value);
+u64 f64_to_sort_key(f64 value);
 
 // O(n)
 // Sorted result is stored in entries
+// Histograms for all digits are collected in single read pass, and passes on digits that are the same for 
+// all keys are skipped. Big arrays are sorted with 11-bit digits, which takes 3 passes instead of 4
 void radix_sort(SortEntry *entries, SortEntry *temp, uptr n);
+
+// Sort for arrays that stay mostly sorted between calls (like render queues, where keys of few 
+// commands change from frame to frame). Caller keeps array sorted in previous call, updates keys
+// and appends new entries, and incremental_sort picks cheapest way of restoring order:
+// - Array is checked for being sorted in single pass
+// - If there are few elements out of order, bounded insertion sort is tried
+// - Otherwise elements that are out of order relative to their neighbours are moved out, sorted and 
+//   merged back
+// - If more than 1/INCREMENTAL_SORT_MAX_CHURN_DEN of elements are out of order, whole array is radix sorted
+// temp should have space for n entries, same as in radix_sort
+#define INCREMENTAL_SORT_MAX_CHURN_DEN 4
+typedef enum {
+    INCREMENTAL_SORT_ALREADY_SORTED,
+    INCREMENTAL_SORT_INSERTION,
+    INCREMENTAL_SORT_MERGE,
+    INCREMENTAL_SORT_RADIX,
+} Incremental_Sort_Path;
+// Returns path that was taken
+Incremental_Sort_Path incremental_sort(SortEntry *entries, SortEntry *temp, uptr n);
+// Same as radix_sort, but work is split between threads of work queue. 
+// Each thread counts digits in its part of array, then offsets of all parts are found from 
+// their combined histograms, so all threads can scatter their parts independently.
+// Small arrays are sorted with radix_sort, as synchronization would cost more than sorting itself.
+// Must be called from thread that adds jobs to queue
+void radix_sort_parallel(struct Work_Queue *queue, SortEntry *entries, SortEntry *temp, uptr n);
+// Histograms for all digits are collected in single pass. Passes on digits that are the same for 
+// all keys are skipped, so keys that only use part of their bits sort faster
+void radix_sort64(SortEntry64 *entries, SortEntry64 *temp, uptr n);
+// Same as radix_sort64, but keys and values are stored in separate arrays. 
+// Histogram pass only reads keys, and 4-byte values move less memory than SortEntry64
+void radix_sort_keys64(u64 *keys, u32 *values, u64 *keys_temp, u32 *values_temp, uptr n);
+
+// Comparison sorts. 
+// Work on arrays of elements of any size, ordered by comparator that returns negative value if a 
+// goes before b, positive if after, and 0 if they are equal (same as qsort).
+// Elements are moved with memcpy, so arrays of pointers or indices sort faster than arrays of big structures
+#define SORT_COMPARE_FUNC(_name) int _name(const void *a, const void *b, void *user_data)
+typedef SORT_COMPARE_FUNC(Sort_Compare_Func);
+
+// Introsort with pattern detection: O(n log n) worst case (falls back to heapsort on bad pivots), 
+// and close to O(n) on already sorted or reversed input. Not stable
+void comparison_sort(void *base, uptr count, uptr stride, Sort_Compare_Func *cmp, void *user_data);
+// Merge sort. Equal elements keep their order.
+// temp should be at least count * stride bytes
+void stable_sort(void *base, uptr count, uptr stride, Sort_Compare_Func *cmp, void *user_data, void *temp);
+// Reorders array so element at nth is the one that would be there if array was sorted, 
+// elements before it are not greater and elements after it are not less than it. O(n) on average
+void select_nth(void *base, uptr count, uptr stride, uptr nth, Sort_Compare_Func *cmp, void *user_data);
+// Puts k smallest elements sorted at the beginning of array, order of others is unspecified.
+// Top-k largest elements are found by flipping comparator
+void partial_sort(void *base, uptr count, uptr stride, uptr k, Sort_Compare_Func *cmp, void *user_data);
+
+// Same algorithms for SortEntry, comparing keys directly instead of calling comparator.
+// For small arrays they are faster than radix_sort, and selection does not need to sort whole array 
+// (for example, nearest k objects can be found with f32_to_sort_key of distances)
+void sort_entries(SortEntry *entries, uptr n);
+void select_nth_entry(SortEntry *entries, uptr n, uptr nth);
+void partial_sort_entries(SortEntry *entries, uptr n, uptr k);
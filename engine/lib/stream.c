@@ -2,24 +2,95 @@
 #include "memory.h"
 #include "strings.h"
 
+#include <stdatomic.h>
+
 static bool
 out_st_needs_flush(OutStream *stream) {
     bool result = false;
-    if (stream->mode == STREAM_FILE || stream->mode == STREAM_STDERR || stream->mode == STREAM_STDOUT) {
+    if (stream->mode == STREAM_FILE || stream->mode == STREAM_STDERR || stream->mode == STREAM_STDOUT ||
+        stream->mode == STREAM_ASYNC_FILE) {
         result = stream->bf_idx >= stream->threshold;
     }
     return result;
 }
+
+static OS_THREAD_PROC_SIGNATURE(out_stream_async_writer_proc) {
+    Out_Stream_Async *async = data;
+    for (;;) {
+        os_semaphore_wait(async->filled_buffers);
+        Out_Stream_Async_Buffer *buffer = async->buffers + async->read_buffer_idx;
+        // Buffer can be reused by stream as soon as it is freed, so save flags
+        u32 flags = buffer->flags;
+        if (buffer->size) {
+            uptr written = os_write_file(async->file, async->file_idx, buffer->data, buffer->size);
+            async->file_idx += written;
+            if (written != buffer->size) {
+                async->has_error = true;
+            }
+        }
+        if ((flags & OUT_STREAM_ASYNC_FSYNC) && !os_sync_file(async->file)) {
+            async->has_error = true;
+        }
+        if (flags & OUT_STREAM_ASYNC_STOP) {
+            break;
+        }
+        async->read_buffer_idx = (async->read_buffer_idx + 1) % async->buffer_count;
+        os_semaphore_signal(async->free_buffers, 1);
+        if (flags & OUT_STREAM_ASYNC_BARRIER) {
+            os_semaphore_signal(async->barrier, 1);
+        }
+    }
+}
+
+// Queue current buffer for writing and switch to next one, waiting if all buffers are queued
+static void out_stream_async_submit(OutStream *stream, u32 flags) {
+    Out_Stream_Async *async = stream->async;
+    Out_Stream_Async_Buffer *buffer = async->buffers + async->write_buffer_idx;
+    buffer->size = stream->bf_idx;
+    buffer->flags = flags;
+    os_semaphore_signal(async->filled_buffers, 1);
+    if (!(flags & OUT_STREAM_ASYNC_STOP)) {
+        async->write_buffer_idx = (async->write_buffer_idx + 1) % async->buffer_count;
+        os_semaphore_wait(async->free_buffers);
+        stream->bf = async->buffers[async->write_buffer_idx].data;
+        stream->bf_idx = 0;
+    }
+}
+
 // When workign with binary data and size of sizngle data block is bigger than
 // threshold, data should be written directly
 static void out_stream_write_direct(OutStream *stream, const void *data, uptr data_sz) {
     if (stream->mode == STREAM_FILE) {
         uptr written = os_write_file(stream->file, stream->file_idx, data, data_sz);
         stream->file_idx += written;
+    } else if (stream->mode == STREAM_STDOUT) {
+        os_write_stdout(data, data_sz);
+    } else if (stream->mode == STREAM_STDERR) {
+        os_write_stderr(data, data_sz);
+    } else if (stream->mode == STREAM_ASYNC_FILE) {
+        // File is owned by writer thread, so data has to be copied through buffers to keep order
+        const u8 *cursor = data;
+        while (data_sz) {
+            uptr chunk_size = stream->bf_sz - stream->bf_idx;
+            if (chunk_size > data_sz) {
+                chunk_size = data_sz;
+            }
+            mem_copy(stream->bf + stream->bf_idx, cursor, chunk_size);
+            stream->bf_idx += chunk_size;
+            cursor += chunk_size;
+            data_sz -= chunk_size;
+            if (stream->bf_idx == stream->bf_sz) {
+                out_stream_async_submit(stream, 0);
+            }
+        }
+        if (out_st_needs_flush(stream)) {
+            out_stream_async_submit(stream, 0);
+        }
     }
 }
 
 void init_out_stream(OutStream *stream, void *bf, uptr bf_sz) {
+    mem_zero(stream, sizeof(*stream));
     stream->mode = STREAM_BUFFER;
     stream->bf = bf;
     stream->bf_sz = bf_sz;
@@ -27,6 +98,7 @@ void init_out_stream(OutStream *stream, void *bf, uptr bf_sz) {
 
 void init_out_streamf(OutStream *stream, OS_File_Handle *file,  void *bf, uptr bf_sz, uptr threshold) {
     assert(threshold < bf_sz);
+    mem_zero(stream, sizeof(*stream));
     stream->file = file;
     stream->mode = STREAM_FILE;
     stream->bf = bf;
@@ -34,6 +106,52 @@ void init_out_streamf(OutStream *stream, OS_File_Handle *file,  void *bf, uptr b
     stream->threshold = threshold;
 }
 
+void init_out_stream_async(OutStream *stream, Out_Stream_Async *async, OS_File_Handle *file,
+                           void *bf, uptr bf_sz, u32 buffer_count, uptr threshold) {
+    assert(buffer_count >= 2 && buffer_count <= OUT_STREAM_ASYNC_MAX_BUFFERS);
+    uptr buffer_size = bf_sz / buffer_count;
+    // Stream is usable in synchronous mode while thread is started, or if it can't be started
+    init_out_streamf(stream, file, bf, buffer_size, threshold);
+    
+    mem_zero(async, sizeof(*async));
+    async->file = file;
+    async->buffer_count = buffer_count;
+    for (u32 buffer_idx = 0; buffer_idx < buffer_count; ++buffer_idx) {
+        async->buffers[buffer_idx].data = (u8 *)bf + buffer_idx * buffer_size;
+    }
+    // First buffer is taken by stream
+    async->free_buffers = os_create_semaphore(buffer_count - 1);
+    async->filled_buffers = os_create_semaphore(0);
+    async->barrier = os_create_semaphore(0);
+    async->thread = os_create_thread(out_stream_async_writer_proc, async);
+    if (async->thread.handle) {
+        stream->mode = STREAM_ASYNC_FILE;
+        stream->async = async;
+    } else {
+        os_destroy_semaphore(async->free_buffers);
+        os_destroy_semaphore(async->filled_buffers);
+        os_destroy_semaphore(async->barrier);
+    }
+}
+
+void destroy_out_stream(OutStream *stream) {
+    if (stream->mode == STREAM_ASYNC_FILE) {
+        Out_Stream_Async *async = stream->async;
+        out_stream_async_submit(stream, OUT_STREAM_ASYNC_STOP);
+        os_join_thread(async->thread);
+        os_destroy_semaphore(async->free_buffers);
+        os_destroy_semaphore(async->filled_buffers);
+        os_destroy_semaphore(async->barrier);
+        // Anything written after this point goes to file directly
+        stream->mode = STREAM_FILE;
+        stream->file_idx = async->file_idx;
+        stream->bf_idx = 0;
+        stream->async = 0;
+    } else {
+        out_stream_flush(stream);
+    }
+}
+
 uptr out_streamf(OutStream *stream, const char *format, ...) {
     va_list args;
     va_start(args, format);
@@ -52,14 +170,20 @@ uptr out_streamv(OutStream *stream, const char *format, va_list args) {
     return bytes_written;   
 }
 
-void out_streamb(OutStream *stream, const void *b, uptr c) {
-    // decide writing policy 
-    if (c <= stream->bf_sz) {
-        if (stream->bf_idx + c >= stream->bf_sz) {
-            out_stream_flush(stream);
+uptr out_streamb(OutStream *stream, const void *b, uptr c) {
+    uptr result = c;
+    if (stream->mode == STREAM_BUFFER) {
+        // Buffer can't be flushed, so only what fits is written
+        uptr space_left = stream->bf_sz - stream->bf_idx;
+        if (result > space_left) {
+            result = space_left;
         }
-        mem_copy(stream->bf, b, c);
-        stream->bf_idx = c;
+        mem_copy(stream->bf + stream->bf_idx, b, result);
+        stream->bf_idx += result;
+    } else if (c <= stream->bf_sz - stream->threshold) {
+        // Stream is flushed every time threshold is passed, so there is always space for small writes
+        mem_copy(stream->bf + stream->bf_idx, b, c);
+        stream->bf_idx += c;
         if (out_st_needs_flush(stream)) {
             out_stream_flush(stream);
         }
@@ -67,6 +191,7 @@ void out_streamb(OutStream *stream, const void *b, uptr c) {
         out_stream_flush(stream);
         out_stream_write_direct(stream, b, c);
     }
+    return result;
 }
 
 void out_stream_flush(OutStream *stream) {
@@ -81,23 +206,141 @@ void out_stream_flush(OutStream *stream) {
     } else if (stream->mode == STREAM_STDERR) {
         os_write_stderr(stream->bf, stream->bf_idx);
         stream->bf_idx = 0;
+    } else if (stream->mode == STREAM_ASYNC_FILE) {
+        if (stream->bf_idx) {
+            out_stream_async_submit(stream, 0);
+        }
+    }
+}
+
+bool out_stream_sync(OutStream *stream, bool sync_to_disk) {
+    bool result = true;
+    if (stream->mode == STREAM_ASYNC_FILE) {
+        Out_Stream_Async *async = stream->async;
+        u32 flags = OUT_STREAM_ASYNC_BARRIER;
+        if (sync_to_disk) {
+            flags |= OUT_STREAM_ASYNC_FSYNC;
+        }
+        out_stream_async_submit(stream, flags);
+        os_semaphore_wait(async->barrier);
+        result = !async->has_error;
+        async->has_error = false;
+    } else {
+        out_stream_flush(stream);
+        if (sync_to_disk && stream->mode == STREAM_FILE) {
+            result = os_sync_file(stream->file);
+        }
     }
+    return result;
 }
 
-void init_in_stream(InStream *stream, void *bf, uptr bf_sz) {
+void init_in_stream(InStream *stream, const void *bf, uptr bf_sz) {
+    mem_zero(stream, sizeof(*stream));
     stream->mode = STREAM_BUFFER;
-    stream->bf = bf;
+    stream->bf = (u8 *)bf;
     stream->bf_sz = bf_sz;
+    stream->bf_used = bf_sz;
+    stream->threshold = bf_sz;
+    stream->is_finished = bf_sz == 0;
 }
 
 void init_in_streamf(InStream *stream, OS_File_Handle *file, void *bf, uptr bf_sz, uptr threshold) {
     assert(bf_sz > threshold);
+    mem_zero(stream, sizeof(*stream));
     stream->file = file;
     stream->file_size = os_get_file_size(file);
     stream->mode = STREAM_FILE;
     stream->bf = bf;
     stream->bf_sz = bf_sz;
     stream->threshold = threshold;
+    stream->is_finished = stream->file_size == 0;
+}
+
+static OS_THREAD_PROC_SIGNATURE(in_stream_read_ahead_reader_proc) {
+    In_Stream_Read_Ahead *read_ahead = data;
+    while (read_ahead->file_idx < read_ahead->file_size) {
+        os_semaphore_wait(read_ahead->free_chunks);
+        if (atomic_load(&read_ahead->stop)) {
+            break;
+        }
+        
+        In_Stream_Read_Ahead_Chunk *chunk = read_ahead->chunks + read_ahead->fill_chunk_idx;
+        uptr read_size = read_ahead->file_size - read_ahead->file_idx;
+        if (read_size > read_ahead->chunk_size) {
+            read_size = read_ahead->chunk_size;
+        }
+        chunk->size = os_read_file(read_ahead->file, read_ahead->file_idx, chunk->data, read_size);
+        read_ahead->file_idx += chunk->size;
+        read_ahead->fill_chunk_idx = (read_ahead->fill_chunk_idx + 1) % read_ahead->chunk_count;
+        os_semaphore_signal(read_ahead->filled_chunks, 1);
+        if (chunk->size == 0) {
+            break;
+        }
+    }
+}
+
+void init_in_stream_read_ahead(InStream *stream, In_Stream_Read_Ahead *read_ahead, OS_File_Handle *file,
+                               void *bf, uptr bf_sz, uptr threshold, void *chunk_bf, uptr chunk_bf_sz, u32 chunk_count) {
+    assert(chunk_count >= 1 && chunk_count <= IN_STREAM_READ_AHEAD_MAX_CHUNKS);
+    // Stream is usable in synchronous mode if thread can't be started
+    init_in_streamf(stream, file, bf, bf_sz, threshold);
+    
+    mem_zero(read_ahead, sizeof(*read_ahead));
+    read_ahead->file = file;
+    read_ahead->file_size = stream->file_size;
+    read_ahead->chunk_count = chunk_count;
+    read_ahead->chunk_size = chunk_bf_sz / chunk_count;
+    assert(read_ahead->chunk_size);
+    for (u32 chunk_idx = 0; chunk_idx < chunk_count; ++chunk_idx) {
+        read_ahead->chunks[chunk_idx].data = (u8 *)chunk_bf + chunk_idx * read_ahead->chunk_size;
+    }
+    read_ahead->free_chunks = os_create_semaphore(chunk_count);
+    read_ahead->filled_chunks = os_create_semaphore(0);
+    read_ahead->thread = os_create_thread(in_stream_read_ahead_reader_proc, read_ahead);
+    if (read_ahead->thread.handle) {
+        stream->mode = STREAM_READ_AHEAD;
+        stream->read_ahead = read_ahead;
+    } else {
+        os_destroy_semaphore(read_ahead->free_chunks);
+        os_destroy_semaphore(read_ahead->filled_chunks);
+    }
+}
+
+bool init_in_stream_mapped(InStream *stream, OS_File_Handle *file) {
+    bool result = false;
+    uptr file_size = os_get_file_size(file);
+    const void *mapping = os_map_file(file, file_size);
+    // Empty files can't be mapped, but are still valid streams
+    if (mapping || (OS_IS_FILE_VALID(file) && file_size == 0)) {
+        // Mapped stream is same as buffer one, except that it owns the mapping
+        init_in_stream(stream, mapping, file_size);
+        stream->mode = STREAM_MAPPED;
+        stream->file = file;
+        stream->file_size = file_size;
+        stream->file_idx = file_size;
+        result = true;
+    }
+    return result;
+}
+
+void destroy_in_stream(InStream *stream) {
+    if (stream->mode == STREAM_MAPPED) {
+        os_unmap_file(stream->bf, stream->file_size);
+    } else if (stream->mode == STREAM_READ_AHEAD) {
+        In_Stream_Read_Ahead *read_ahead = stream->read_ahead;
+        atomic_store(&read_ahead->stop, true);
+        // Wake reader if it waits for free chunk
+        os_semaphore_signal(read_ahead->free_chunks, 1);
+        os_join_thread(read_ahead->thread);
+        os_destroy_semaphore(read_ahead->free_chunks);
+        os_destroy_semaphore(read_ahead->filled_chunks);
+    }
+    mem_zero(stream, sizeof(*stream));
+}
+
+static void in_stream_update_is_finished(InStream *stream) {
+    stream->is_finished = stream->bf_idx == stream->bf_used && 
+        ((stream->mode != STREAM_FILE && stream->mode != STREAM_READ_AHEAD) || stream->file_idx == stream->file_size);
 }
 
 uptr in_stream_peek(InStream *stream, void *out, uptr n) {
@@ -107,19 +350,80 @@ uptr in_stream_peek(InStream *stream, void *out, uptr n) {
             in_stream_flush(stream);
         }
         
-        if (stream->bf_idx + n <= stream->bf_used) {
-            mem_copy(out, stream->bf + stream->bf_idx, n);
+        result = stream->bf_used - stream->bf_idx;
+        if (result > n) {
             result = n;
-        } else {
-            NOT_IMPLEMENTED;
+        }
+        mem_copy(out, stream->bf + stream->bf_idx, result);
+        // Peek is bigger than buffer can hold - read rest directly from file without caching it
+        if (result < n && stream->mode == STREAM_FILE) {
+            uptr direct_size = stream->file_size - stream->file_idx;
+            if (direct_size > n - result) {
+                direct_size = n - result;
+            }
+            result += os_read_file(stream->file, stream->file_idx, (u8 *)out + result, direct_size);
         }
     }      
     return result;
 }
 
+uptr in_stream_peek_ptr(InStream *stream, const u8 **out) {
+    if ((stream->mode == STREAM_FILE || stream->mode == STREAM_READ_AHEAD) && stream->bf_idx == stream->bf_used) {
+        in_stream_flush(stream);
+    }
+    *out = stream->bf + stream->bf_idx;
+    return stream->bf_used - stream->bf_idx;
+}
+
+uptr in_stream_read(InStream *stream, void *out, uptr n) {
+    uptr result = 0;
+    if (stream->mode == STREAM_FILE && n > stream->bf_sz - stream->threshold) {
+        // Take what is buffered and read the rest from file straight to out. Going through peek and
+        // advance would read the rest twice - once by peek and once more by flush in advance
+        if (!stream->is_finished) {
+            result = stream->bf_used - stream->bf_idx;
+            if (result > n) {
+                result = n;
+            }
+            mem_copy(out, stream->bf + stream->bf_idx, result);
+            stream->bf_idx += result;
+            uptr direct_size = stream->file_size - stream->file_idx;
+            if (direct_size > n - result) {
+                direct_size = n - result;
+            }
+            if (direct_size) {
+                uptr bytes_read = os_read_file(stream->file, stream->file_idx, (u8 *)out + result, direct_size);
+                stream->file_idx += bytes_read;
+                result += bytes_read;
+                if (bytes_read != direct_size) {
+                    // File was truncated while reading, treat what we have as the end
+                    stream->file_size = stream->file_idx;
+                }
+            }
+            
+            if (stream->bf_idx > stream->threshold || stream->bf_idx == stream->bf_used) {
+                in_stream_flush(stream);
+            }
+            in_stream_update_is_finished(stream);
+        }
+    } else {
+        // Peek can return less than asked for if stream does not support peeking past buffer end,
+        // so read in parts until end of stream
+        while (result < n) {
+            uptr peeked = in_stream_peek(stream, (u8 *)out + result, n - result);
+            if (!peeked) {
+                break;
+            }
+            in_stream_advance(stream, peeked);
+            result += peeked;
+        }
+    }
+    return result;
+}
+
 u8 in_stream_soft_peek_at(InStream *stream, uptr offset) {
     u8 result = 0;
-    if (stream->bf_idx + offset <= stream->bf_used) {
+    if (stream->bf_idx + offset < stream->bf_used) {
         result = stream->bf[stream->bf_idx + offset];
     }
     return result;
@@ -132,28 +436,48 @@ uptr in_stream_advance(InStream *stream, uptr n) {
             in_stream_flush(stream);
         }
         
-        if (stream->bf_idx + n <= stream->bf_used) {
-            stream->bf_idx += n;
-            result += n;
-            
-            if (stream->bf_idx > stream->threshold) {
-                in_stream_flush(stream);
+        result = stream->bf_used - stream->bf_idx;
+        if (result > n) {
+            result = n;
+        }
+        stream->bf_idx += result;
+        // Advance is bigger than buffer can hold - skip rest in file without reading it
+        if (result < n && stream->mode == STREAM_FILE) {
+            uptr skip_size = stream->file_size - stream->file_idx;
+            if (skip_size > n - result) {
+                skip_size = n - result;
+            }
+            stream->file_idx += skip_size;
+            result += skip_size;
+        }
+        // File position is owned by reader thread, so chunks have to be consumed to skip data
+        while (result < n && stream->mode == STREAM_READ_AHEAD && stream->file_idx < stream->file_size) {
+            in_stream_flush(stream);
+            uptr skip_size = stream->bf_used - stream->bf_idx;
+            if (skip_size > n - result) {
+                skip_size = n - result;
             }
-        } else {
-            NOT_IMPLEMENTED;
+            stream->bf_idx += skip_size;
+            result += skip_size;
+        }
+            
+        if (stream->bf_idx > stream->threshold || stream->bf_idx == stream->bf_used) {
+            in_stream_flush(stream);
         }
+        in_stream_update_is_finished(stream);
     }
     return result;
 }
 
 void in_stream_flush(InStream *stream) {
-    if (stream->mode == STREAM_BUFFER) {
+    if (stream->mode == STREAM_BUFFER || stream->mode == STREAM_MAPPED) {
         // nop
     } else if (stream->mode == STREAM_FILE) {
         // Move chunk of file that is not processed to buffer start
-        assert(stream->bf_idx < stream->bf_sz);
-        mem_move(stream->bf, stream->bf + stream->bf_idx, stream->bf_used - stream->bf_idx);
-        stream->bf_used = stream->bf_idx;
+        assert(stream->bf_idx <= stream->bf_used);
+        uptr unprocessed_size = stream->bf_used - stream->bf_idx;
+        mem_move(stream->bf, stream->bf + stream->bf_idx, unprocessed_size);
+        stream->bf_used = unprocessed_size;
         stream->bf_idx = 0;
         // Read new data
         uptr buffer_size_aviable = stream->bf_sz - stream->bf_used;
@@ -161,14 +485,51 @@ void in_stream_flush(InStream *stream) {
         if (read_data_size > buffer_size_aviable) {
             read_data_size = buffer_size_aviable;
         }
-        uptr bytes_read = os_read_file(stream->file, stream->file_idx, stream->bf + stream->bf_used, read_data_size);
-        stream->bf_used += bytes_read;
-        stream->file_idx += bytes_read;
-        if (bytes_read == 0) {
-            // @TODO buggy
-            stream->is_finished = true;
+        if (read_data_size) {
+            uptr bytes_read = os_read_file(stream->file, stream->file_idx, stream->bf + stream->bf_used, read_data_size);
+            stream->bf_used += bytes_read;
+            stream->file_idx += bytes_read;
+            if (bytes_read != read_data_size) {
+                // File was truncated while reading, treat what we have as the end
+                stream->file_size = stream->file_idx;
+            }
+        }
+    } else if (stream->mode == STREAM_READ_AHEAD) {
+        In_Stream_Read_Ahead *read_ahead = stream->read_ahead;
+        uptr unprocessed_size = stream->bf_used - stream->bf_idx;
+        mem_move(stream->bf, stream->bf + stream->bf_idx, unprocessed_size);
+        stream->bf_used = unprocessed_size;
+        stream->bf_idx = 0;
+        // Copy data from chunks that are already read, waiting for reader only if it is behind
+        while (stream->bf_used < stream->bf_sz && stream->file_idx < stream->file_size) {
+            if (!read_ahead->has_consume_chunk) {
+                os_semaphore_wait(read_ahead->filled_chunks);
+                read_ahead->has_consume_chunk = true;
+                read_ahead->consume_chunk_offset = 0;
+            }
+            
+            In_Stream_Read_Ahead_Chunk *chunk = read_ahead->chunks + read_ahead->consume_chunk_idx;
+            if (chunk->size == 0) {
+                // Reader failed to read, treat what we have as the end
+                stream->file_size = stream->file_idx;
+                break;
+            }
+            uptr copy_size = chunk->size - read_ahead->consume_chunk_offset;
+            if (copy_size > stream->bf_sz - stream->bf_used) {
+                copy_size = stream->bf_sz - stream->bf_used;
+            }
+            mem_copy(stream->bf + stream->bf_used, chunk->data + read_ahead->consume_chunk_offset, copy_size);
+            stream->bf_used += copy_size;
+            stream->file_idx += copy_size;
+            read_ahead->consume_chunk_offset += copy_size;
+            if (read_ahead->consume_chunk_offset == chunk->size) {
+                read_ahead->has_consume_chunk = false;
+                read_ahead->consume_chunk_idx = (read_ahead->consume_chunk_idx + 1) % read_ahead->chunk_count;
+                os_semaphore_signal(read_ahead->free_chunks, 1);
+            }
         }
     } 
+    in_stream_update_is_finished(stream);
 }
 
 u8 in_stream_peek_b_or_zero(InStream *stream) {
@@ -36,9 +36,59 @@ enum {
     STREAM_BUFFER,
     STREAM_FILE,
     STREAM_STDOUT,
-    STREAM_STDERR
+    STREAM_STDERR,
+    // Input only. Whole file is mapped into memory and buffer points into mapping
+    STREAM_MAPPED,
+    // Output only. Filled buffers are written to file by background thread
+    STREAM_ASYNC_FILE,
+    // Input only. Next chunks of file are read by background thread while current is parsed
+    STREAM_READ_AHEAD
 };
 
+#define OUT_STREAM_ASYNC_MAX_BUFFERS 8
+
+enum {
+    // Writer signals barrier semaphore after buffer is written
+    OUT_STREAM_ASYNC_BARRIER = 0x1,
+    // Writer syncs file to disk after buffer is written
+    OUT_STREAM_ASYNC_FSYNC   = 0x2,
+    // Last buffer submitted, writer thread exits after writing it
+    OUT_STREAM_ASYNC_STOP    = 0x4,
+};
+
+typedef struct {
+    u8 *data;
+    // Set by producer on submission
+    uptr size;
+    u32 flags;
+} Out_Stream_Async_Buffer;
+
+// State shared by asynchronous stream and its writer thread.
+// Buffers form a ring: stream fills one of them, and the rest are either free or queued
+// for writing. When all buffers are queued the stream blocks until writer frees one,
+// so at most buffer_count - 1 buffers worth of data can be waiting for disk.
+typedef struct Out_Stream_Async {
+    OS_File_Handle *file;
+    OS_Thread thread;
+    // Number of buffers that stream can take for filling 
+    OS_Semaphore free_buffers;
+    // Number of buffers queued for writing
+    OS_Semaphore filled_buffers;
+    OS_Semaphore barrier;
+    
+    u32 buffer_count;
+    Out_Stream_Async_Buffer buffers[OUT_STREAM_ASYNC_MAX_BUFFERS];
+    // Owned by stream
+    u32 write_buffer_idx;
+    // Owned by writer thread
+    u32 read_buffer_idx;
+    uptr file_idx;
+    // Set by writer thread when write or sync fails. Writer can't log, because log itself can be 
+    // written by async stream, so error is reported by out_stream_sync.
+    // Only read and cleared by stream after barrier, when writer is idle
+    bool has_error;
+} Out_Stream_Async;
+
 // Stream is an object that supports continously writing to while having
 // relatively stable write time perfomance.
 // Streams are used to write to output files, but OS write calls are quite expnesive.
@@ -56,19 +106,74 @@ typedef struct {
     uptr threshold;
     
     uptr bf_idx;
+    // Only in STREAM_ASYNC_FILE mode
+    Out_Stream_Async *async;
 } OutStream;
 
+// Create stream for writing to user buffer. Nothing is written after buffer is full
+void init_out_stream(OutStream *stream, void *bf, uptr bf_sz);
 // Create stream for writing to file.
 // bf_sz - what size of buffer to allocate 
 // threshold >= bf_sz
 // bf - storage for stream buffer
 void init_out_streamf(OutStream *stream, OS_File_Handle *file_handle,
     void *bf, uptr bf_sz, uptr threshold);
+// Create stream for writing to file on background thread.
+// bf is split into buffer_count buffers, threshold applies to each of them.
+// If writer thread can't be created stream falls back to synchronous writing.
+// Stream must be destroyed with destroy_out_stream to stop the thread
+void init_out_stream_async(OutStream *stream, Out_Stream_Async *async, OS_File_Handle *file_handle,
+    void *bf, uptr bf_sz, u32 buffer_count, uptr threshold);
+// Flushes stream and stops writer thread of asynchronous stream. 
+// Stream stays usable, but writes synchronously after that
+void destroy_out_stream(OutStream *stream);
 // Printfs to stream
 __attribute__((__format__ (__printf__, 2, 3)))
 uptr out_streamf(OutStream *stream, const char *fmt, ...);
 uptr out_streamv(OutStream *stream, const char *fmt, va_list args);
+// Writes c bytes to stream. Blocks bigger than bf_sz - threshold bypass buffer and are written directly.
+// Returns number of bytes written, which is less than c only if buffer stream ran out of space
+uptr out_streamb(OutStream *stream, const void *b, uptr c);
+// Write buffered data. Asynchronous streams only hand current buffer over to writer thread
 void out_stream_flush(OutStream *stream);
+// Flush and wait until all data is written to file. If sync_to_disk is set data is also 
+// guaranteed to reach the disk.
+// Returns false if writing to file failed since last call, or if file could not be synced
+bool out_stream_sync(OutStream *stream, bool sync_to_disk);
+
+#define IN_STREAM_READ_AHEAD_MAX_CHUNKS 8
+
+typedef struct {
+    u8 *data;
+    // Number of bytes reader thread has read. 0 means that read failed and reading stopped
+    uptr size;
+} In_Stream_Read_Ahead_Chunk;
+
+// State shared by read ahead stream and its reader thread.
+// Chunks form a ring that is filled by reader in file order and consumed by stream in the 
+// same order. Reader blocks when all chunks are filled, and stream blocks only when it gets 
+// ahead of reader.
+typedef struct In_Stream_Read_Ahead {
+    OS_File_Handle *file;
+    uptr file_size;
+    OS_Thread thread;
+    // Number of chunks reader can fill
+    OS_Semaphore free_chunks;
+    // Number of chunks stream can consume
+    OS_Semaphore filled_chunks;
+    _Atomic(bool) stop;
+    
+    uptr chunk_size;
+    u32 chunk_count;
+    In_Stream_Read_Ahead_Chunk chunks[IN_STREAM_READ_AHEAD_MAX_CHUNKS];
+    // Owned by stream
+    u32 consume_chunk_idx;
+    uptr consume_chunk_offset;
+    bool has_consume_chunk;
+    // Owned by reader thread
+    u32 fill_chunk_idx;
+    uptr file_idx;
+} In_Stream_Read_Ahead;
 
 // Threshold defines how much of additonal data is read between flushes.
 // For example, buffer may be 6 kb and threshold 4kb. Then 
@@ -81,7 +186,7 @@ void out_stream_flush(OutStream *stream);
 // at buffer start. So, the bigger the bf_sz - thrreshold, the more stream can read at once, 
 // but the more time it spends on copying and moving around memory
 // Way around this can be allowing buffer of growing size 
-// @NOTE no flusing happens when in stream uses buffer to read from
+// @NOTE no flusing happens when in stream uses buffer or mapped file to read from
 typedef struct {
     u32 mode;
     
@@ -100,15 +205,44 @@ typedef struct {
     // After what number bf_idx should be reset and buffer refilled
     uptr threshold;
     bool is_finished;
+    // Only in STREAM_READ_AHEAD mode
+    In_Stream_Read_Ahead *read_ahead;
 } InStream;
 
+// Create stream for reading from user buffer
+void init_in_stream(InStream *stream, const void *bf, uptr bf_sz);
 void init_in_streamf(InStream *stream, OS_File_Handle *file, void *bf, uptr bf_sz, uptr threshold);
+// Create stream that reads file sequentially on background thread.
+// Works like stream created with init_in_streamf, but flushes copy data from chunks that 
+// reader thread has already read instead of waiting on os. chunk_bf is split into chunk_count 
+// chunks, which are all read ahead of stream.
+// @NOTE Peeks past buffer end are not supported in this mode, in_stream_peek returns only
+// what fits in buffer.
+// If reader thread can't be created stream falls back to synchronous reading.
+// Stream must be destroyed with destroy_in_stream to stop the thread
+void init_in_stream_read_ahead(InStream *stream, In_Stream_Read_Ahead *read_ahead, OS_File_Handle *file,
+    void *bf, uptr bf_sz, uptr threshold, void *chunk_bf, uptr chunk_bf_sz, u32 chunk_count);
+// Create stream reading from whole file mapped into memory. No copies are made on reads, 
+// and in_stream_peek_ptr can access any part of file that has not been read yet.
+// Returns false if file can't be mapped, in that case init_in_streamf should be used
+bool init_in_stream_mapped(InStream *stream, OS_File_Handle *file);
+// Releases mapping of mapped stream and stops reader thread of read ahead stream. 
+// Nop for other modes
+void destroy_in_stream(InStream *stream);
 // Peek next n bytes without advancing the cursor
-// Returns number of bytes peeked
+// Returns number of bytes peeked. It is less than n only if end of stream is reached
 uptr in_stream_peek(InStream *stream, void *out, uptr n);
+// Get pointer to data that is not read yet without copying it. 
+// Returns number of bytes that can be accessed through *out. For mapped and buffer streams
+// this is whole rest of stream, for file streams - what is currently cached in buffer.
+// Pointer is valid until next call to advance or flush
+uptr in_stream_peek_ptr(InStream *stream, const u8 **out);
 u8 in_stream_soft_peek_at(InStream *stream, uptr offset);
+// Read next n bytes and advance the cursor. Big reads from file streams bypass buffer.
+// Returns number of bytes read. It is less than n only if end of stream is reached
+uptr in_stream_read(InStream *stream, void *out, uptr n);
 // Advance stream by n bytes. 
-// Return numbef of bytes advanced by
+// Return numbef of bytes advanced by. It is less than n only if end of stream is reached
 uptr in_stream_advance(InStream *stream, uptr n);
 // If stream is bufferized, read next file chunk to fill the buffer as much as possible
 void in_stream_flush(InStream *stream);
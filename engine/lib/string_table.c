@@ -0,0 +1,111 @@
+#include "string_table.h"
+
+#include <stdatomic.h>
+
+// Number of entries committed at a time
+#define STRING_TABLE_COMMIT_GRANULARITY 1024
+
+// 0 and (u64)-1 are reserved keys in Concurrent_Hash64
+static u64 
+string_table_key(Text str) {
+    u64 hash = hash_text(str);
+    if (hash == 0 || hash == (u64)-1) {
+        hash = 1;
+    }
+    return hash;
+}
+
+static String_ID 
+string_table_find_internal(String_Table *table, Text str, u64 key) {
+    String_ID result = STRING_ID_INVALID;
+    String_ID id = (String_ID)concurrent_hash64_get(&table->ids, key, STRING_ID_INVALID);
+    while (id != STRING_ID_INVALID) {
+        String_Table_Entry *entry = table->entries + id;
+        if (text_eq(entry->text, str)) {
+            result = id;
+            break;
+        }
+        id = entry->next_with_same_hash;
+    }
+    return result;
+}
+
+void 
+init_string_table(String_Table *table) {
+    mem_zero(table, sizeof(*table));
+    init_concurrent_hash64(&table->ids, 256);
+    table->committed_count = STRING_TABLE_COMMIT_GRANULARITY;
+    table->entries = mem_reserve_tagged(STRING_TABLE_MAX_STRINGS * sizeof(String_Table_Entry), 
+        table->committed_count * sizeof(String_Table_Entry), MEMORY_TAG_STRING);
+    // Id 0 is invalid, so first entry is never used
+    atomic_init(&table->count, 1);
+}
+
+void 
+destroy_string_table(String_Table *table) {
+    destroy_concurrent_hash64(&table->ids);
+    mem_release(table->entries);
+    arena_clear(&table->arena);
+    mem_zero(table, sizeof(*table));
+}
+
+String_ID 
+intern_text(String_Table *table, Text str) {
+    u64 key = string_table_key(str);
+    String_ID result = string_table_find_internal(table, str, key);
+    if (result == STRING_ID_INVALID) {
+        u32 unlocked = 0;
+        while (!atomic_compare_exchange_weak_explicit(&table->insert_lock, &unlocked, 1, 
+                memory_order_acquire, memory_order_relaxed)) {
+            unlocked = 0;
+        }
+        
+        // String could have been inserted while we were waiting for lock
+        result = string_table_find_internal(table, str, key);
+        if (result == STRING_ID_INVALID) {
+            result = atomic_load_explicit(&table->count, memory_order_relaxed);
+            assert(result < STRING_TABLE_MAX_STRINGS);
+            if (result >= table->committed_count) {
+                table->committed_count += STRING_TABLE_COMMIT_GRANULARITY;
+                bool committed = mem_commit(table->entries, table->committed_count * sizeof(String_Table_Entry));
+                assert(committed);
+                UNUSED(committed);
+            }
+            
+            char *data = arena_push(&table->arena, str.len + 1);
+            mem_copy(data, str.data, str.len);
+            data[str.len] = 0;
+            
+            String_Table_Entry *entry = table->entries + result;
+            entry->text = text(data, str.len);
+            entry->next_with_same_hash = (String_ID)concurrent_hash64_get(&table->ids, key, STRING_ID_INVALID);
+            atomic_store_explicit(&table->count, result + 1, memory_order_release);
+            // Entry is filled before it is published in hash table, so readers that find id can use it
+            concurrent_hash64_set(&table->ids, key, result);
+        }
+        
+        atomic_store_explicit(&table->insert_lock, 0, memory_order_release);
+    }
+    return result;
+}
+
+String_ID 
+intern_string(String_Table *table, const char *str) {
+    return intern_text(table, text(str, (u32)str_len(str)));
+}
+
+String_ID 
+string_table_find(String_Table *table, Text str) {
+    return string_table_find_internal(table, str, string_table_key(str));
+}
+
+Text 
+string_table_text(String_Table *table, String_ID id) {
+    assert(id != STRING_ID_INVALID && id < atomic_load_explicit(&table->count, memory_order_acquire));
+    return table->entries[id].text;
+}
+
+const char *
+string_table_str(String_Table *table, String_ID id) {
+    return string_table_text(table, id).data;
+}
@@ -0,0 +1,53 @@
+// Author: Holodome
+// Date: 17.10.2021 
+// File: engine/lib/string_table.h
+// Version: 0
+// 
+// String interning.
+// Each distinct string is stored once and is given compact id, so checking strings for equality 
+// becomes integer comparison and ids can be used as keys in hash tables and stored in place of pointers.
+// Ids are stable for lifetime of table. 0 is never given out, so zero-initialized ids mean 'no string'.
+// 
+// String contents are kept in arena and are zero-terminated, so they can be passed to apis expecting c strings.
+// Lookups (finding id of string and getting string by id) are lock-free and can be done from any thread.
+// Interning new strings is serialized with spin lock, interning string that is already present does 
+// not take lock.
+#pragma once
+#include "lib/general.h"
+#include "memory.h"
+#include "strings.h"
+#include "hashing.h"
+
+#define STRING_ID_INVALID 0
+// Address space for this number of entries is reserved upfront, so entries never move
+#define STRING_TABLE_MAX_STRINGS (1u << 24)
+
+typedef u32 String_ID;
+
+typedef struct {
+    Text text;
+    // Next string that has same hash
+    String_ID next_with_same_hash;
+} String_Table_Entry;
+
+typedef struct String_Table {
+    // Storage for string contents
+    Memory_Arena arena;
+    // Maps string hash to id of last interned string with that hash
+    Concurrent_Hash64 ids;
+    // Indexed with string id
+    String_Table_Entry *entries;
+    _Atomic(u32) count;
+    u32 committed_count;
+    _Atomic(u32) insert_lock;
+} String_Table;
+
+void init_string_table(String_Table *table);
+void destroy_string_table(String_Table *table);
+String_ID intern_text(String_Table *table, Text str);
+String_ID intern_string(String_Table *table, const char *str);
+// Returns STRING_ID_INVALID if string was not interned
+String_ID string_table_find(String_Table *table, Text str);
+Text string_table_text(String_Table *table, String_ID id);
+// Returns zero-terminated string 
+const char *string_table_str(String_Table *table, String_ID id);
@@ -8,6 +8,7 @@
 #include "lib/general.h"
 #define KB(_b) ((uptr)(_b) << 10)
 #define MB(_b) (KB(_b) << 10)
+#define GB(_b) (MB(_b) << 10)
 #define IS_POW2(_n) ( ( (_n) & ((_n) - 1) ) == 0 )
 u32 align_to_next_pow2(u32 v);
 u64 align_forward(u64 value, u64 align);
@@ -0,0 +1,102 @@
+#include "work_queue.h"
+#include "memory.h"
+
+#include <stdatomic.h>
+
+// How many times thread waiting in work_queue_complete_all checks for completion before it starts 
+// giving up its time slice
+#define WORK_QUEUE_WAIT_SPIN_COUNT 128
+
+// Returns true if there was no work to do
+static bool 
+work_queue_do_next_entry(Work_Queue *queue) {
+    bool is_empty = false;
+    u32 next_entry_to_read = atomic_load(&queue->next_entry_to_read);
+    if (next_entry_to_read != atomic_load(&queue->next_entry_to_write)) {
+        u32 new_next_entry_to_read = (next_entry_to_read + 1) % WORK_QUEUE_MAX_ENTRIES;
+        if (atomic_compare_exchange_strong(&queue->next_entry_to_read, &next_entry_to_read, new_next_entry_to_read)) {
+            Work_Queue_Entry entry = queue->entries[next_entry_to_read];
+            entry.callback(entry.data);
+            atomic_fetch_add(&queue->completion_count, 1);
+        }
+    } else {
+        is_empty = true;
+    }
+    return is_empty;
+}
+
+static OS_THREAD_PROC_SIGNATURE(work_queue_thread_proc) {
+    Work_Queue *queue = data;
+    while (atomic_load(&queue->is_running)) {
+        if (work_queue_do_next_entry(queue)) {
+            os_semaphore_wait(queue->semaphore);
+        }
+    }
+}
+
+void 
+init_work_queue(Work_Queue *queue, u32 thread_count) {
+    mem_zero(queue, sizeof(*queue));
+    if (thread_count > WORK_QUEUE_MAX_THREADS) {
+        thread_count = WORK_QUEUE_MAX_THREADS;
+    }
+    atomic_init(&queue->is_running, true);
+    queue->semaphore = os_create_semaphore(0);
+    for (u32 i = 0; i < thread_count; ++i) {
+        OS_Thread thread = os_create_thread(work_queue_thread_proc, queue);
+        if (thread.handle) {
+            queue->threads[queue->thread_count++] = thread;
+        }
+    }
+}
+
+void 
+shutdown_work_queue(Work_Queue *queue) {
+    work_queue_complete_all(queue);
+    atomic_store(&queue->is_running, false);
+    os_semaphore_signal(queue->semaphore, queue->thread_count);
+    for (u32 i = 0; i < queue->thread_count; ++i) {
+        os_join_thread(queue->threads[i]);
+    }
+    os_destroy_semaphore(queue->semaphore);
+    queue->thread_count = 0;
+}
+
+void 
+work_queue_add(Work_Queue *queue, Work_Queue_Callback *callback, void *data) {
+    u32 next_entry_to_write = atomic_load_explicit(&queue->next_entry_to_write, memory_order_relaxed);
+    u32 new_next_entry_to_write = (next_entry_to_write + 1) % WORK_QUEUE_MAX_ENTRIES;
+    assert(new_next_entry_to_write != atomic_load(&queue->next_entry_to_read));
+    Work_Queue_Entry *entry = queue->entries + next_entry_to_write;
+    entry->callback = callback;
+    entry->data = data;
+    atomic_fetch_add(&queue->completion_goal, 1);
+    // Entry is published only after it is written
+    atomic_store(&queue->next_entry_to_write, new_next_entry_to_write);
+    os_semaphore_signal(queue->semaphore, 1);
+}
+
+void 
+work_queue_complete_all(Work_Queue *queue) {
+    u32 spin_count = 0;
+    while (atomic_load(&queue->completion_goal) != atomic_load(&queue->completion_count)) {
+        if (!work_queue_do_next_entry(queue)) {
+            spin_count = 0;
+        } else if (spin_count < WORK_QUEUE_WAIT_SPIN_COUNT) {
+            // Queue is empty and last jobs are being finished by workers. They are usually almost 
+            // done, so spin for a bit before yielding, which would add scheduler latency
+            ++spin_count;
+            CPU_PAUSE();
+        } else {
+            // Don't take core from workers that could run on it
+            os_yield_thread();
+        }
+    }
+    atomic_store(&queue->completion_goal, 0);
+    atomic_store(&queue->completion_count, 0);
+}
+
+u32 
+work_queue_parallelism(Work_Queue *queue) {
+    return queue->thread_count + 1;
+}
@@ -0,0 +1,48 @@
+// Author: Holodome
+// Date: 17.10.2021 
+// File: engine/lib/work_queue.h
+// Version: 0
+// 
+// Pool of worker threads that execute jobs from shared queue.
+// Jobs are added by single thread (usually main one), which then waits for them with 
+// work_queue_complete_all. While waiting, that thread executes jobs too, so it is never idle 
+// and queue with 0 worker threads still works - all jobs are done in work_queue_complete_all.
+// Workers sleep on semaphore when queue is empty.
+#pragma once
+#include "lib/general.h"
+#include "platform/os.h"
+
+#define WORK_QUEUE_MAX_ENTRIES 256
+#define WORK_QUEUE_MAX_THREADS 64
+
+#define WORK_QUEUE_CALLBACK(_name) void _name(void *data)
+typedef WORK_QUEUE_CALLBACK(Work_Queue_Callback);
+
+typedef struct {
+    Work_Queue_Callback *callback;
+    void *data;
+} Work_Queue_Entry;
+
+typedef struct Work_Queue {
+    _Atomic(u32) completion_goal;
+    _Atomic(u32) completion_count;
+    _Atomic(u32) next_entry_to_write;
+    _Atomic(u32) next_entry_to_read;
+    _Atomic(bool) is_running;
+    OS_Semaphore semaphore;
+    Work_Queue_Entry entries[WORK_QUEUE_MAX_ENTRIES];
+    
+    u32 thread_count;
+    OS_Thread threads[WORK_QUEUE_MAX_THREADS];
+} Work_Queue;
+
+void init_work_queue(Work_Queue *queue, u32 thread_count);
+// Waits for all workers to finish
+void shutdown_work_queue(Work_Queue *queue);
+// Only one thread can add jobs
+void work_queue_add(Work_Queue *queue, Work_Queue_Callback *callback, void *data);
+// Executes jobs until all added ones are completed
+void work_queue_complete_all(Work_Queue *queue);
+// Number of threads that execute jobs, including one that calls work_queue_complete_all.
+// Used to decide how many pieces work should be split into
+u32 work_queue_parallelism(Work_Queue *queue);
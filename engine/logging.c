@@ -6,6 +6,8 @@
 // @TODO(hl): Replace this 
 #include <time.h> // localtime
 
+// Log file is written on background thread, so logging does not stall on disk
+#define LOGGING_BUFFER_COUNT 2
 #define LOGGING_BUFFER_SIZE KB(16)
 #define LOGGING_BUFFER_THRESHOLD KB(4)
 
@@ -38,6 +40,7 @@ typedef struct Logging_State {
     
     File_ID log_file_id;
     OutStream log_stream;
+    Out_Stream_Async log_stream_async;
     u32 current_color;
 } Logging_State;  
 
@@ -77,15 +80,17 @@ log_time() {
 }
 
 struct Logging_State *
-create_logging_state(const char *filename) {
-    // @LEAK
-    Logging_State *state_local = mem_alloc(sizeof(Logging_State));
+create_logging_state(Memory_Arena *arena, const char *filename) {
+    Logging_State *state_local = arena_push_struct(arena, Logging_State);
     state_local->is_initialized = true;
     state_local->log_file_id = fs_open_file(filename, FILE_MODE_WRITE);
-    init_out_streamf(&state_local->log_stream, fs_get_handle(state_local->log_file_id), 
-        mem_alloc(LOGGING_BUFFER_SIZE), LOGGING_BUFFER_SIZE,
-        LOGGING_BUFFER_THRESHOLD);
+    // Stream is usable while writer thread is started, so errors can be logged 
     init_logging(state_local);
+    init_out_stream_async(&state_local->log_stream, &state_local->log_stream_async, 
+        fs_get_handle(state_local->log_file_id), 
+        arena_push(arena, LOGGING_BUFFER_SIZE * LOGGING_BUFFER_COUNT), 
+        LOGGING_BUFFER_SIZE * LOGGING_BUFFER_COUNT, LOGGING_BUFFER_COUNT,
+        LOGGING_BUFFER_THRESHOLD);
     return state;
 }
 
@@ -94,10 +99,11 @@ init_logging(struct Logging_State *state_init) {
     state = state_init;
 }
 
-void shutdown_logging() {
+void 
+shutdown_logging(struct Logging_State *state_shutdown) {
+    UNUSED(state_shutdown);
     ASSERT_INITIALIZED;
-    out_stream_flush(&state->log_stream);
-    mem_free(state->log_stream.bf, state->log_stream.bf_sz);
+    destroy_out_stream(&state->log_stream);
 }
 
 void 
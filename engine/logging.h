@@ -6,10 +6,11 @@ Version: 0
 */
 #pragma once 
 #include "lib/general.h"
+#include "lib/memory.h"
 
 struct Logging_State;
 
-struct Logging_State *create_logging_state(const char *filename);
+struct Logging_State *create_logging_state(Memory_Arena *arena, const char *filename);
 void init_logging(struct Logging_State *state);
 void shutdown_logging(struct Logging_State *state);
 
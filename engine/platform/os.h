@@ -60,11 +60,19 @@ ENGINE_PUB u64 os_write_stderr(const void *bf, uptr bf_sz);
 // Files
 ENGINE_PUB void os_open_file(OS_File_Handle *handle, const char *filename, u32 mode);
 ENGINE_PUB void os_close_file(OS_File_Handle *handle);
+// Return number of bytes written or read, 0 on error
 ENGINE_PUB u64 os_write_file(OS_File_Handle *file, u64 offset, const void *bf, u64 bf_sz);
 ENGINE_PUB u64 os_read_file(OS_File_Handle *file, u64 offset, void *bf, u64 bf_sz);
+// Block until data written to file reaches the disk. 
+// Does not log errors, so it can be called by thread that writes log file
+ENGINE_PUB bool os_sync_file(OS_File_Handle *file);
 ENGINE_PUB u64 os_get_file_size(OS_File_Handle *handle);
 ENGINE_PUB File_Time os_get_file_write_time(const char *filename);
 ENGINE_PUB int os_cmp_file_write_time(File_Time a, File_Time b);
+// Map size bytes of file read-only into address space. Pages are loaded by os on first access, so 
+// reading mapped file requires no copies. Returns 0 on failure
+ENGINE_PUB const void *os_map_file(OS_File_Handle *file, uptr size);
+ENGINE_PUB void os_unmap_file(const void *ptr, uptr size);
 
 // General file/directory management
 ENGINE_PUB uptr os_fmt_executable_path(char *bf, uptr bf_sz);
@@ -73,6 +81,82 @@ ENGINE_PUB void os_fmt_cwd(char *bf, uptr bf_sz);
 ENGINE_PUB bool os_copy_file(const char *a, const char *b);
 ENGINE_PUB void os_delete_file(const char *filename);
 ENGINE_PUB bool os_file_exists(const char *filename);
+// Virtual memory
+// Reserved memory is not accessible until committed. All sizes should be multiple of page size
+ENGINE_PUB uptr os_get_page_size(void);
+ENGINE_PUB void *os_reserve_memory(uptr size);
+ENGINE_PUB bool os_commit_memory(void *ptr, uptr size);
+ENGINE_PUB void os_decommit_memory(void *ptr, uptr size);
+ENGINE_PUB void os_release_memory(void *ptr, uptr size);
+// Ask os to back reserved range with huge pages. Returns false if not supported
+ENGINE_PUB bool os_advise_huge_pages(void *ptr, uptr size);
+// Number of bytes of process memory that is currently backed by huge pages, if os reports it
+ENGINE_PUB uptr os_get_huge_page_usage(void);
+// Threads
+// handle value of 0 means invalid handle
+typedef struct {
+    u64 handle;
+} OS_Thread;
+
+#define OS_THREAD_PROC_SIGNATURE(_name) void _name(void *data)
+typedef OS_THREAD_PROC_SIGNATURE(OS_Thread_Proc);
+
+ENGINE_PUB OS_Thread os_create_thread(OS_Thread_Proc *proc, void *data);
+// Waits for thread to finish
+ENGINE_PUB void os_join_thread(OS_Thread thread);
+// Give rest of time slice to other threads
+ENGINE_PUB void os_yield_thread(void);
+// Number of logical cores
+ENGINE_PUB u32 os_get_cpu_count(void);
+// Monotonic time, used for measuring intervals
+ENGINE_PUB u64 os_get_nanoseconds(void);
+// Counting semaphore, used to put threads to sleep until there is work for them
+typedef struct {
+    void *handle;
+} OS_Semaphore;
+
+ENGINE_PUB OS_Semaphore os_create_semaphore(u32 initial_count);
+ENGINE_PUB void os_destroy_semaphore(OS_Semaphore semaphore);
+ENGINE_PUB void os_semaphore_signal(OS_Semaphore semaphore, u32 count);
+ENGINE_PUB void os_semaphore_wait(OS_Semaphore semaphore);
+// Batched asynchronous file io
+// Requests are submitted in batches and complete in any order, so many small reads can be 
+// in flight with single call to os. Queue should be used from single thread.
+// Request memory must stay valid until request is returned from os_wait_io
+enum {
+    OS_IO_READ,
+    OS_IO_WRITE,
+};
+
+typedef struct {
+    u32 op;
+    OS_File_Handle *file;
+    u64 offset;
+    void *bf;
+    u64 bf_sz;
+    // Not used by os
+    void *user_data;
+    // Set on completion. Number of bytes transferred, which is less than bf_sz only at end of file 
+    // or on error
+    u64 result;
+    bool has_error;
+} OS_IO_Request;
+
+// handle value of 0 means invalid handle
+typedef struct {
+    void *handle;
+} OS_IO_Queue;
+
+// max_in_flight - how many submitted requests can be not yet returned from os_wait_io
+ENGINE_PUB OS_IO_Queue os_create_io_queue(u32 max_in_flight);
+// Waits for requests in flight to complete
+ENGINE_PUB void os_destroy_io_queue(OS_IO_Queue queue);
+// Returns number of requests submitted, which is less than count if queue is full or os is 
+// out of resources. Requests that were not submitted can be submitted again later
+ENGINE_PUB u32 os_submit_io(OS_IO_Queue queue, OS_IO_Request *requests, u32 count);
+// Write up to max_count completed requests to completed, waiting until at least min_count of 
+// them are available. min_count of 0 only polls. Returns number of requests written
+ENGINE_PUB u32 os_wait_io(OS_IO_Queue queue, OS_IO_Request **completed, u32 min_count, u32 max_count);
 // Dlls
 ENGINE_PUB DLL_Handle os_load_dll(const char *dllname);
 ENGINE_PUB void os_unload_dll(DLL_Handle handle);
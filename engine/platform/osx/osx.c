@@ -4,104 +4,10 @@
 #include "lib/memory.h"
 #include "lib/hashing.h"
 
-#include "logging.h"
-
 #include <sys/syslimits.h>
 #include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <errno.h>
-#include <string.h> // strerror
 #include <copyfile.h> // copyfile
-#include <dlfcn.h> // dlopen, dlclose, dlsymb
-
-#define posix_dump_errno() \
-posix_dump_errno_(__FILE__, __LINE__)
-static void
-posix_dump_errno_(const char *filename, u32 line) {
-    int err_no = errno;
-    if (err_no) {
-        char *err_str = strerror(err_no);
-        log_debug("errno at %s:%u %u: %s",
-            filename, line,
-            err_no, err_str);    
-    }
-}
-
-void os_open_file(OS_File_Handle *handle, const char *filename, u32 mode) {
-    handle->flags = 0;
-    handle->handle = 0;
-    
-    int posix_mode = 0;
-    if (mode == FILE_MODE_READ) {
-        posix_mode |= O_RDONLY;
-    } else if (mode == FILE_MODE_WRITE) {
-        posix_mode |= O_WRONLY | O_TRUNC | O_CREAT;
-    } 
-    int permissions = 0777;
-    int posix_handle = open(filename, posix_mode, permissions);
-    if (posix_handle > 0) {
-        handle->handle = posix_handle;
-    } else if (posix_handle == -1) {
-        handle->flags |= FILE_FLAG_HAS_ERRORS;
-        DBG_BREAKPOINT;
-    }
-}
-
-void os_close_file(OS_File_Handle *handle) {
-    bool result = close(handle->handle) == 0;
-    if (result) {
-        handle->flags |= FILE_FLAG_IS_CLOSED;
-    }
-}
-
-u64 os_write_file(OS_File_Handle *file, u64 offset, const void *bf, u64 bf_sz) {
-    uptr result = 0;
-    if (OS_IS_FILE_VALID(file)) {
-        int posix_handle = file->handle;
-        lseek(posix_handle, offset, SEEK_SET);
-        ssize_t written = write(posix_handle, bf, bf_sz);
-        if (written == -1) {
-            DBG_BREAKPOINT;
-        }
-        result = written;
-    } else {
-        DBG_BREAKPOINT;
-    }
-    return result;
-}
-
-u64 os_read_file(OS_File_Handle *file, u64 offset, void *bf, u64 bf_sz) {
-    uptr result = 0;
-    if (OS_IS_FILE_VALID(file)) {
-        int posix_handle = file->handle;
-        lseek(posix_handle, offset, SEEK_SET);
-        ssize_t nread = read(posix_handle, bf, bf_sz);
-        if (nread == -1) {
-            DBG_BREAKPOINT;
-        }
-        result = nread;
-    } else {
-        DBG_BREAKPOINT;
-    }
-    return result;
-}
-u64 os_write_stdout(const void *bf, uptr bf_sz) {
-    return write(1, bf, bf_sz);
-}
-
-u64 os_write_stderr(const void *bf, uptr bf_sz) {
-    return write(2, bf, bf_sz);
-}
-
-u64 os_get_file_size(OS_File_Handle *handle) {
-    uptr result = 0;
-    if (OS_IS_FILE_VALID(handle)) {
-        int posix_handle = handle->handle;
-        result = lseek(posix_handle, 0, SEEK_END);
-    }      
-    return result;
-}
+#include <mach-o/dyld.h> // _NSGetExecutablePath
 
 u32 
 osx_scancode_to_key(u32 scancode) {
@@ -247,20 +153,6 @@ os_fmt_executable_path(char *bf, uptr bf_sz) {
     return result;
 }
 
-void 
-os_chdir(const char *dir) {
-    int result = chdir(dir);   
-    UNUSED(result);
-    if (result != 0) {
-        posix_dump_errno();
-    } 
-}
-
-void 
-os_fmt_cwd(char *bf, uptr bf_sz) {
-    getcwd(bf, bf_sz);    
-}
-
 File_Time 
 os_get_file_write_time(const char *filename) {
     File_Time result = {0};
@@ -288,35 +180,3 @@ os_copy_file(const char *a, const char *b) {
     int result = copyfile(a, b, 0, COPYFILE_ALL);
     return result == 0;
 }
-
-DLL_Handle
-os_load_dll(const char *dllname) {
-    DLL_Handle result;
-    result.handle = dlopen(dllname, RTLD_NOW);
-    return result;
-}
-
-void 
-os_unload_dll(DLL_Handle handle) {
-    dlclose(handle.handle);
-}
-
-void *
-os_dll_symb(DLL_Handle handle, const char *symb) {
-    void *result = dlsym(handle.handle, symb);
-    return result;
-}
-
-void 
-os_delete_file(const char *filename) {
-    int result = unlink(filename);
-    if (result != 0) {
-        posix_dump_errno();
-    }
-}
-
-bool 
-os_file_exists(const char *filename) {
-    bool result = access(filename, F_OK) == 0;
-    return result;
-}
\ No newline at end of file
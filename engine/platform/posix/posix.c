@@ -0,0 +1,811 @@
+// Implementation of os functions that are the same on all posix systems (macos and linux).
+// Linux-only parts (io_uring, huge page statistics) are compiled conditionally, so this file
+// builds on both. Functions that need system-specific apis are in osx/osx.c
+#if defined(__linux__)
+// mmap flags, syscall and other non-standard apis are hidden in strict c11 mode otherwise
+#define _GNU_SOURCE
+#endif 
+#include "platform/os.h"
+
+#include "lib/strings.h"
+#include "lib/memory.h"
+
+#include "logging.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h> // strerror
+#include <dlfcn.h> // dlopen, dlclose, dlsymb
+#include <sys/mman.h> // mmap, mprotect, munmap
+#include <pthread.h>
+#include <sched.h> // sched_yield
+#include <time.h> // clock_gettime
+#include <stdatomic.h>
+
+#if !defined(POSIX_IO_USE_URING)
+#define POSIX_IO_USE_URING OS_LINUX
+#endif 
+
+#if POSIX_IO_USE_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif 
+
+// Single io_uring operation is limited to 32 bits, rest of bigger request is submitted on its completion
+#if !defined(POSIX_IO_URING_MAX_OPERATION_SIZE)
+#define POSIX_IO_URING_MAX_OPERATION_SIZE 0x7FFFF000
+#endif 
+
+#define posix_dump_errno() \
+posix_dump_errno_(__FILE__, __LINE__)
+static void
+posix_dump_errno_(const char *filename, u32 line) {
+    int err_no = errno;
+    if (err_no) {
+        char *err_str = strerror(err_no);
+        log_debug("errno at %s:%u %u: %s",
+            filename, line,
+            err_no, err_str);    
+    }
+}
+
+void os_open_file(OS_File_Handle *handle, const char *filename, u32 mode) {
+    handle->flags = 0;
+    handle->handle = 0;
+    
+    int posix_mode = 0;
+    if (mode == FILE_MODE_READ) {
+        posix_mode |= O_RDONLY;
+    } else if (mode == FILE_MODE_WRITE) {
+        posix_mode |= O_WRONLY | O_TRUNC | O_CREAT;
+    } 
+    int permissions = 0777;
+    int posix_handle = open(filename, posix_mode, permissions);
+    if (posix_handle > 0) {
+        handle->handle = posix_handle;
+    } else if (posix_handle == -1) {
+        handle->flags |= FILE_FLAG_HAS_ERRORS;
+        DBG_BREAKPOINT;
+    }
+}
+
+void os_close_file(OS_File_Handle *handle) {
+    bool result = close(handle->handle) == 0;
+    if (result) {
+        handle->flags |= FILE_FLAG_IS_CLOSED;
+    }
+}
+
+// Transfer whole buffer, unless end of file is reached. pread and pwrite don't use file position, 
+// so same handle can be used from several threads at once. 
+// Returns number of bytes transferred, has_error is set if transfer failed
+static u64 
+posix_transfer(int posix_handle, u32 op, u8 *bf, u64 bf_sz, u64 offset, bool *has_error) {
+    u64 result = 0;
+    *has_error = false;
+    while (result < bf_sz) {
+        ssize_t transferred;
+        if (op == OS_IO_READ) {
+            transferred = pread(posix_handle, bf + result, bf_sz - result, offset + result);
+        } else {
+            transferred = pwrite(posix_handle, bf + result, bf_sz - result, offset + result);
+        }
+        
+        if (transferred > 0) {
+            result += transferred;
+        } else if (transferred == 0) {
+            break;
+        } else if (errno != EINTR) {
+            *has_error = true;
+            break;
+        }
+    }
+    return result;
+}
+
+u64 os_write_file(OS_File_Handle *file, u64 offset, const void *bf, u64 bf_sz) {
+    uptr result = 0;
+    if (OS_IS_FILE_VALID(file)) {
+        bool has_error;
+        result = posix_transfer(file->handle, OS_IO_WRITE, (u8 *)bf, bf_sz, offset, &has_error);
+        if (has_error) {
+            result = 0;
+            DBG_BREAKPOINT;
+        }
+    } else {
+        DBG_BREAKPOINT;
+    }
+    return result;
+}
+
+u64 os_read_file(OS_File_Handle *file, u64 offset, void *bf, u64 bf_sz) {
+    uptr result = 0;
+    if (OS_IS_FILE_VALID(file)) {
+        bool has_error;
+        result = posix_transfer(file->handle, OS_IO_READ, bf, bf_sz, offset, &has_error);
+        if (has_error) {
+            result = 0;
+            DBG_BREAKPOINT;
+        }
+    } else {
+        DBG_BREAKPOINT;
+    }
+    return result;
+}
+
+bool 
+os_sync_file(OS_File_Handle *file) {
+    bool result = false;
+    if (OS_IS_FILE_VALID(file)) {
+        int posix_handle = file->handle;
+#if defined(F_FULLFSYNC)
+        // On macos fsync only passes data to drive, which may still keep it in its cache
+        result = fcntl(posix_handle, F_FULLFSYNC) == 0;
+        if (!result) {
+            result = fsync(posix_handle) == 0;
+        }
+#else 
+        result = fsync(posix_handle) == 0;
+#endif 
+    }
+    return result;
+}
+
+u64 os_write_stdout(const void *bf, uptr bf_sz) {
+    return write(1, bf, bf_sz);
+}
+
+u64 os_write_stderr(const void *bf, uptr bf_sz) {
+    return write(2, bf, bf_sz);
+}
+
+u64 os_get_file_size(OS_File_Handle *handle) {
+    uptr result = 0;
+    if (OS_IS_FILE_VALID(handle)) {
+        int posix_handle = handle->handle;
+        result = lseek(posix_handle, 0, SEEK_END);
+    }      
+    return result;
+}
+
+const void *
+os_map_file(OS_File_Handle *file, uptr size) {
+    const void *result = 0;
+    if (OS_IS_FILE_VALID(file) && size) {
+        int posix_handle = file->handle;
+        void *mapping = mmap(0, size, PROT_READ, MAP_PRIVATE, posix_handle, 0);
+        if (mapping != MAP_FAILED) {
+            // Mapped files are mostly read from start to end, so let os read ahead aggressively
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            result = mapping;
+        } else {
+            posix_dump_errno();
+        }
+    }
+    return result;
+}
+
+void 
+os_unmap_file(const void *ptr, uptr size) {
+    if (ptr) {
+        munmap((void *)ptr, size);
+    }
+}
+
+void 
+os_chdir(const char *dir) {
+    int result = chdir(dir);   
+    UNUSED(result);
+    if (result != 0) {
+        posix_dump_errno();
+    } 
+}
+
+void 
+os_fmt_cwd(char *bf, uptr bf_sz) {
+    getcwd(bf, bf_sz);    
+}
+
+DLL_Handle
+os_load_dll(const char *dllname) {
+    DLL_Handle result;
+    result.handle = dlopen(dllname, RTLD_NOW);
+    return result;
+}
+
+void 
+os_unload_dll(DLL_Handle handle) {
+    dlclose(handle.handle);
+}
+
+void *
+os_dll_symb(DLL_Handle handle, const char *symb) {
+    void *result = dlsym(handle.handle, symb);
+    return result;
+}
+
+void 
+os_delete_file(const char *filename) {
+    int result = unlink(filename);
+    if (result != 0) {
+        posix_dump_errno();
+    }
+}
+
+bool 
+os_file_exists(const char *filename) {
+    bool result = access(filename, F_OK) == 0;
+    return result;
+}
+
+uptr 
+os_get_page_size(void) {
+    return sysconf(_SC_PAGESIZE);
+}
+
+void *
+os_reserve_memory(uptr size) {
+    void *result = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (result == MAP_FAILED) {
+        posix_dump_errno();
+        result = 0;
+    }
+    return result;
+}
+
+bool 
+os_commit_memory(void *ptr, uptr size) {
+    bool result = mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+    if (!result) {
+        posix_dump_errno();
+    }
+    return result;
+}
+
+void 
+os_decommit_memory(void *ptr, uptr size) {
+    // Mapping over the range gives physical pages back to os, so memory is zero when committed again
+    if (mmap(ptr, size, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANON, -1, 0) == MAP_FAILED) {
+        // Fails if process is out of mappings, old mapping is still in place then. Drop its pages and
+        // protect it instead. Dropped pages read as zero again on linux, but macos may keep their contents
+        posix_dump_errno();
+        bool is_decommitted = madvise(ptr, size, MADV_DONTNEED) == 0 &&
+            mprotect(ptr, size, PROT_NONE) == 0;
+        if (!is_decommitted) {
+            posix_dump_errno();
+        }
+        assert(is_decommitted);
+    }
+}
+
+void 
+os_release_memory(void *ptr, uptr size) {
+    munmap(ptr, size);
+}
+
+bool 
+os_advise_huge_pages(void *ptr, uptr size) {
+    bool result = false;
+#if defined(MADV_HUGEPAGE)
+    // Transparent huge pages. Works only if they are enabled in 'madvise' or 'always' mode
+    result = madvise(ptr, size, MADV_HUGEPAGE) == 0;
+#else 
+    // @TODO(hl): Superpages on macos can only be allocated with mach_vm_allocate with
+    // VM_FLAGS_SUPERPAGE_SIZE_2MB, which does not work with reserve/commit scheme
+    UNUSED(ptr);
+    UNUSED(size);
+#endif 
+    return result;
+}
+
+uptr 
+os_get_huge_page_usage(void) {
+    uptr result = 0;
+#if OS_LINUX
+    int fd = open("/proc/self/smaps_rollup", O_RDONLY);
+    if (fd != -1) {
+        char bf[4096];
+        ssize_t nread = read(fd, bf, sizeof(bf) - 1);
+        close(fd);
+        if (nread > 0) {
+            bf[nread] = 0;
+            const char *field = strstr(bf, "AnonHugePages:");
+            if (field) {
+                result = (uptr)str_to_i64(field + sizeof("AnonHugePages:") - 1) * 1024;
+            }
+        }
+    }
+#endif 
+    return result;
+}
+
+typedef struct {
+    OS_Thread_Proc *proc;
+    void *data;
+} Posix_Thread_Start;
+
+static void *
+posix_thread_start(void *data_init) {
+    Posix_Thread_Start start = *(Posix_Thread_Start *)data_init;
+    mem_free(data_init, sizeof(Posix_Thread_Start));
+    start.proc(start.data);
+    mem_flush_thread_cache();
+    return 0;
+}
+
+OS_Thread 
+os_create_thread(OS_Thread_Proc *proc, void *data) {
+    OS_Thread result = {0};
+    Posix_Thread_Start *start = mem_alloc(sizeof(Posix_Thread_Start));
+    start->proc = proc;
+    start->data = data;
+    pthread_t thread;
+    int error = pthread_create(&thread, 0, posix_thread_start, start);
+    if (error == 0) {
+        result.handle = (u64)thread;
+    } else {
+        log_error("Failed to create thread: %s", strerror(error));
+        mem_free(start, sizeof(Posix_Thread_Start));
+    }
+    return result;
+}
+
+void 
+os_join_thread(OS_Thread thread) {
+    if (thread.handle) {
+        pthread_join((pthread_t)thread.handle, 0);
+    }
+}
+
+void 
+os_yield_thread(void) {
+    sched_yield();
+}
+
+u32 
+os_get_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+}
+
+u64 
+os_get_nanoseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (u64)time.tv_sec * 1000000000llu + (u64)time.tv_nsec;
+}
+
+// Unnamed posix semaphores are not supported on macos, so semaphore is built from mutex and condition variable
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    u32 count;
+} Posix_Semaphore;
+
+OS_Semaphore 
+os_create_semaphore(u32 initial_count) {
+    Posix_Semaphore *semaphore = mem_alloc(sizeof(Posix_Semaphore));
+    pthread_mutex_init(&semaphore->mutex, 0);
+    pthread_cond_init(&semaphore->cond, 0);
+    semaphore->count = initial_count;
+    OS_Semaphore result;
+    result.handle = semaphore;
+    return result;
+}
+
+void 
+os_destroy_semaphore(OS_Semaphore semaphore_handle) {
+    Posix_Semaphore *semaphore = semaphore_handle.handle;
+    if (semaphore) {
+        pthread_cond_destroy(&semaphore->cond);
+        pthread_mutex_destroy(&semaphore->mutex);
+        mem_free(semaphore, sizeof(Posix_Semaphore));
+    }
+}
+
+void 
+os_semaphore_signal(OS_Semaphore semaphore_handle, u32 count) {
+    Posix_Semaphore *semaphore = semaphore_handle.handle;
+    pthread_mutex_lock(&semaphore->mutex);
+    semaphore->count += count;
+    pthread_mutex_unlock(&semaphore->mutex);
+    if (count == 1) {
+        pthread_cond_signal(&semaphore->cond);
+    } else {
+        pthread_cond_broadcast(&semaphore->cond);
+    }
+}
+
+void 
+os_semaphore_wait(OS_Semaphore semaphore_handle) {
+    Posix_Semaphore *semaphore = semaphore_handle.handle;
+    pthread_mutex_lock(&semaphore->mutex);
+    while (!semaphore->count) {
+        pthread_cond_wait(&semaphore->cond, &semaphore->mutex);
+    }
+    --semaphore->count;
+    pthread_mutex_unlock(&semaphore->mutex);
+}
+
+// Batched io is done with io_uring where it is available, and with pool of threads doing 
+// blocking reads otherwise
+#define POSIX_IO_THREAD_COUNT 4
+
+typedef struct {
+    u32 max_in_flight;
+    // Submitted requests that were not returned from os_wait_io yet
+    u32 in_flight;
+    bool is_uring;
+#if POSIX_IO_USE_URING
+    int ring_fd;
+    void *sq_ring;
+    uptr sq_ring_size;
+    void *cq_ring;
+    uptr cq_ring_size;
+    struct io_uring_sqe *sqes;
+    uptr sqes_size;
+    _Atomic(u32) *sq_tail;
+    u32 *sq_ring_mask;
+    u32 *sq_array;
+    _Atomic(u32) *cq_head;
+    _Atomic(u32) *cq_tail;
+    u32 *cq_ring_mask;
+    struct io_uring_cqe *cqes;
+#endif 
+    // Thread pool
+    pthread_mutex_t mutex;
+    pthread_cond_t has_pending;
+    pthread_cond_t has_completed;
+    // Rings of max_in_flight requests
+    OS_IO_Request **pending;
+    u32 pending_read_idx;
+    u32 pending_count;
+    OS_IO_Request **completed;
+    u32 completed_read_idx;
+    u32 completed_count;
+    bool is_stopping;
+    u32 thread_count;
+    pthread_t threads[POSIX_IO_THREAD_COUNT];
+} Posix_IO_Queue;
+
+static void 
+posix_execute_io(OS_IO_Request *request) {
+    request->result = 0;
+    request->has_error = !OS_IS_FILE_VALID(request->file);
+    if (!request->has_error) {
+        request->result = posix_transfer(request->file->handle, request->op, request->bf, request->bf_sz, 
+            request->offset, &request->has_error);
+    }
+}
+
+static void 
+posix_io_queue_push_completed(Posix_IO_Queue *queue, OS_IO_Request *request) {
+    u32 idx = (queue->completed_read_idx + queue->completed_count) % queue->max_in_flight;
+    queue->completed[idx] = request;
+    ++queue->completed_count;
+}
+
+static void *
+posix_io_worker_proc(void *data) {
+    Posix_IO_Queue *queue = data;
+    pthread_mutex_lock(&queue->mutex);
+    for (;;) {
+        while (!queue->pending_count && !queue->is_stopping) {
+            pthread_cond_wait(&queue->has_pending, &queue->mutex);
+        }
+        if (!queue->pending_count) {
+            break;
+        }
+        
+        OS_IO_Request *request = queue->pending[queue->pending_read_idx];
+        queue->pending_read_idx = (queue->pending_read_idx + 1) % queue->max_in_flight;
+        --queue->pending_count;
+        pthread_mutex_unlock(&queue->mutex);
+        posix_execute_io(request);
+        pthread_mutex_lock(&queue->mutex);
+        posix_io_queue_push_completed(queue, request);
+        pthread_cond_signal(&queue->has_completed);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+}
+
+#if POSIX_IO_USE_URING
+static bool 
+posix_init_io_uring(Posix_IO_Queue *queue) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = syscall(__NR_io_uring_setup, queue->max_in_flight, &params);
+    if (ring_fd < 0) {
+        return false;
+    }
+    // IORING_OP_READ and IORING_OP_WRITE appeared in 5.6, same as this flag
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring_fd);
+        return false;
+    }
+    
+    queue->ring_fd = ring_fd;
+    queue->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    queue->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    queue->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (queue->cq_ring_size > queue->sq_ring_size) {
+            queue->sq_ring_size = queue->cq_ring_size;
+        }
+        queue->cq_ring_size = queue->sq_ring_size;
+    }
+    
+    queue->sq_ring = mmap(0, queue->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+        ring_fd, IORING_OFF_SQ_RING);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        queue->cq_ring = queue->sq_ring;
+    } else {
+        queue->cq_ring = mmap(0, queue->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+            ring_fd, IORING_OFF_CQ_RING);
+    }
+    queue->sqes = mmap(0, queue->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+        ring_fd, IORING_OFF_SQES);
+    if (queue->sq_ring == MAP_FAILED || queue->cq_ring == MAP_FAILED || queue->sqes == MAP_FAILED) {
+        posix_dump_errno();
+        if (queue->sq_ring != MAP_FAILED) {
+            munmap(queue->sq_ring, queue->sq_ring_size);
+        }
+        if (queue->cq_ring != MAP_FAILED && queue->cq_ring != queue->sq_ring) {
+            munmap(queue->cq_ring, queue->cq_ring_size);
+        }
+        if (queue->sqes != MAP_FAILED) {
+            munmap(queue->sqes, queue->sqes_size);
+        }
+        close(ring_fd);
+        return false;
+    }
+    
+    u8 *sq_ring = queue->sq_ring;
+    u8 *cq_ring = queue->cq_ring;
+    queue->sq_tail = (_Atomic(u32) *)(sq_ring + params.sq_off.tail);
+    queue->sq_ring_mask = (u32 *)(sq_ring + params.sq_off.ring_mask);
+    queue->sq_array = (u32 *)(sq_ring + params.sq_off.array);
+    queue->cq_head = (_Atomic(u32) *)(cq_ring + params.cq_off.head);
+    queue->cq_tail = (_Atomic(u32) *)(cq_ring + params.cq_off.tail);
+    queue->cq_ring_mask = (u32 *)(cq_ring + params.cq_off.ring_mask);
+    queue->cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    return true;
+}
+
+static u32 
+posix_submit_io_uring(Posix_IO_Queue *queue, OS_IO_Request *requests, u32 count) {
+    // Kernel consumes all entries on enter, so ring always has space for max_in_flight entries 
+    u32 tail = atomic_load_explicit(queue->sq_tail, memory_order_relaxed);
+    for (u32 request_idx = 0; request_idx < count; ++request_idx) {
+        OS_IO_Request *request = requests + request_idx;
+        u32 idx = tail & *queue->sq_ring_mask;
+        struct io_uring_sqe *sqe = queue->sqes + idx;
+        // While request is in flight, result is number of bytes transferred by its previous operations
+        u64 remaining = request->bf_sz - request->result;
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = request->op == OS_IO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = OS_IS_FILE_VALID(request->file) ? (int)request->file->handle : -1;
+        sqe->off = request->offset + request->result;
+        sqe->addr = (u64)((u8 *)request->bf + request->result);
+        sqe->len = remaining > POSIX_IO_URING_MAX_OPERATION_SIZE ? POSIX_IO_URING_MAX_OPERATION_SIZE : (u32)remaining;
+        sqe->user_data = (u64)request;
+        queue->sq_array[idx] = idx;
+        ++tail;
+    }
+    atomic_store_explicit(queue->sq_tail, tail, memory_order_release);
+    
+    u32 submitted = 0;
+    while (submitted < count) {
+        int result = syscall(__NR_io_uring_enter, queue->ring_fd, count - submitted, 0, 0, 0, 0);
+        if (result > 0) {
+            submitted += result;
+        } else if (result == 0 || errno != EINTR) {
+            // EAGAIN and EBUSY mean that kernel is short on resources until some requests complete
+            if (result < 0 && errno != EAGAIN && errno != EBUSY) {
+                posix_dump_errno();
+            }
+            break;
+        }
+    }
+    // Kernel takes entries in order, so ones it did not take are at the end of ring. 
+    // Without SQPOLL kernel reads ring only inside enter, so they can be taken back, and 
+    // caller submits these requests again later
+    if (submitted < count) {
+        atomic_store_explicit(queue->sq_tail, tail - (count - submitted), memory_order_release);
+    }
+    return submitted;
+}
+
+static u32 
+posix_wait_io_uring(Posix_IO_Queue *queue, OS_IO_Request **completed, u32 min_count, u32 max_count) {
+    u32 result = 0;
+    for (;;) {
+        u32 head = atomic_load_explicit(queue->cq_head, memory_order_relaxed);
+        u32 tail = atomic_load_explicit(queue->cq_tail, memory_order_acquire);
+        while (head != tail && result < max_count) {
+            struct io_uring_cqe *cqe = queue->cqes + (head & *queue->cq_ring_mask);
+            OS_IO_Request *request = (OS_IO_Request *)cqe->user_data;
+            i32 transferred = cqe->res;
+            ++head;
+            if (transferred > 0) {
+                request->result += transferred;
+            }
+            // Operation has transferred less than requested, but has not reached end of file. 
+            // This happens for requests bigger than single operation can be and for partial 
+            // transfers. Rest is submitted again, so request completes same as with io threads
+            if (transferred > 0 && request->result < request->bf_sz) {
+                if (!posix_submit_io_uring(queue, request, 1)) {
+                    // Kernel is out of resources, so do the rest right away
+                    bool has_error = !OS_IS_FILE_VALID(request->file);
+                    if (!has_error) {
+                        request->result += posix_transfer(request->file->handle, request->op, 
+                            (u8 *)request->bf + request->result, request->bf_sz - request->result, 
+                            request->offset + request->result, &has_error);
+                    }
+                    request->has_error = has_error;
+                    completed[result++] = request;
+                }
+            } else {
+                request->has_error = transferred < 0;
+                completed[result++] = request;
+            }
+        }
+        atomic_store_explicit(queue->cq_head, head, memory_order_release);
+        if (result >= min_count) {
+            break;
+        }
+        
+        int enter_result = syscall(__NR_io_uring_enter, queue->ring_fd, 0, min_count - result, IORING_ENTER_GETEVENTS, 0, 0);
+        if (enter_result < 0 && errno != EINTR) {
+            posix_dump_errno();
+            break;
+        }
+    }
+    return result;
+}
+#endif 
+
+OS_IO_Queue 
+os_create_io_queue(u32 max_in_flight) {
+    assert(max_in_flight);
+    Posix_IO_Queue *queue = mem_alloc(sizeof(Posix_IO_Queue));
+    queue->max_in_flight = max_in_flight;
+#if POSIX_IO_USE_URING
+    queue->is_uring = posix_init_io_uring(queue);
+#endif 
+    if (!queue->is_uring) {
+        pthread_mutex_init(&queue->mutex, 0);
+        pthread_cond_init(&queue->has_pending, 0);
+        pthread_cond_init(&queue->has_completed, 0);
+        queue->pending = mem_alloc(max_in_flight * sizeof(*queue->pending));
+        queue->completed = mem_alloc(max_in_flight * sizeof(*queue->completed));
+        for (u32 thread_idx = 0; thread_idx < POSIX_IO_THREAD_COUNT; ++thread_idx) {
+            int error = pthread_create(queue->threads + queue->thread_count, 0, posix_io_worker_proc, queue);
+            if (error == 0) {
+                ++queue->thread_count;
+            } else {
+                log_error("Failed to create io thread: %s", strerror(error));
+            }
+        }
+    }
+    OS_IO_Queue result;
+    result.handle = queue;
+    return result;
+}
+
+u32 
+os_submit_io(OS_IO_Queue queue_handle, OS_IO_Request *requests, u32 count) {
+    Posix_IO_Queue *queue = queue_handle.handle;
+    if (count > queue->max_in_flight - queue->in_flight) {
+        count = queue->max_in_flight - queue->in_flight;
+    }
+    
+    u32 result = 0;
+#if POSIX_IO_USE_URING
+    if (queue->is_uring) {
+        for (u32 request_idx = 0; request_idx < count; ++request_idx) {
+            requests[request_idx].result = 0;
+            requests[request_idx].has_error = false;
+        }
+        result = posix_submit_io_uring(queue, requests, count);
+    }
+#endif 
+    if (!queue->is_uring) {
+        pthread_mutex_lock(&queue->mutex);
+        for (u32 request_idx = 0; request_idx < count; ++request_idx) {
+            OS_IO_Request *request = requests + request_idx;
+            if (queue->thread_count) {
+                u32 idx = (queue->pending_read_idx + queue->pending_count) % queue->max_in_flight;
+                queue->pending[idx] = request;
+                ++queue->pending_count;
+            } else {
+                // No threads could be started, so do io right away
+                posix_execute_io(request);
+                posix_io_queue_push_completed(queue, request);
+            }
+        }
+        pthread_mutex_unlock(&queue->mutex);
+        if (count == 1) {
+            pthread_cond_signal(&queue->has_pending);
+        } else if (count) {
+            pthread_cond_broadcast(&queue->has_pending);
+        }
+        result = count;
+    }
+    queue->in_flight += result;
+    return result;
+}
+
+u32 
+os_wait_io(OS_IO_Queue queue_handle, OS_IO_Request **completed, u32 min_count, u32 max_count) {
+    Posix_IO_Queue *queue = queue_handle.handle;
+    if (min_count > max_count) {
+        min_count = max_count;
+    }
+    if (min_count > queue->in_flight) {
+        min_count = queue->in_flight;
+    }
+    
+    u32 result = 0;
+#if POSIX_IO_USE_URING
+    if (queue->is_uring) {
+        result = posix_wait_io_uring(queue, completed, min_count, max_count);
+    }
+#endif 
+    if (!queue->is_uring) {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->completed_count < min_count) {
+            pthread_cond_wait(&queue->has_completed, &queue->mutex);
+        }
+        result = queue->completed_count < max_count ? queue->completed_count : max_count;
+        for (u32 completed_idx = 0; completed_idx < result; ++completed_idx) {
+            completed[completed_idx] = queue->completed[queue->completed_read_idx];
+            queue->completed_read_idx = (queue->completed_read_idx + 1) % queue->max_in_flight;
+        }
+        queue->completed_count -= result;
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    queue->in_flight -= result;
+    return result;
+}
+
+void 
+os_destroy_io_queue(OS_IO_Queue queue_handle) {
+    Posix_IO_Queue *queue = queue_handle.handle;
+    if (queue) {
+        // Kernel and worker threads may still write to request memory, so wait for them
+        OS_IO_Request *completed[64];
+        while (queue->in_flight) {
+            os_wait_io(queue_handle, completed, 1, ARRAY_SIZE(completed));
+        }
+        
+#if POSIX_IO_USE_URING
+        if (queue->is_uring) {
+            munmap(queue->sqes, queue->sqes_size);
+            if (queue->cq_ring != queue->sq_ring) {
+                munmap(queue->cq_ring, queue->cq_ring_size);
+            }
+            munmap(queue->sq_ring, queue->sq_ring_size);
+            close(queue->ring_fd);
+        }
+#endif 
+        if (!queue->is_uring) {
+            pthread_mutex_lock(&queue->mutex);
+            queue->is_stopping = true;
+            pthread_mutex_unlock(&queue->mutex);
+            pthread_cond_broadcast(&queue->has_pending);
+            for (u32 thread_idx = 0; thread_idx < queue->thread_count; ++thread_idx) {
+                pthread_join(queue->threads[thread_idx], 0);
+            }
+            pthread_cond_destroy(&queue->has_completed);
+            pthread_cond_destroy(&queue->has_pending);
+            pthread_mutex_destroy(&queue->mutex);
+            mem_free(queue->pending, queue->max_in_flight * sizeof(*queue->pending));
+            mem_free(queue->completed, queue->max_in_flight * sizeof(*queue->completed));
+        }
+        mem_free(queue, sizeof(Posix_IO_Queue));
+    }
+}
@@ -1,12 +1,36 @@
 #include "renderer/renderer.h"
 
 #include "vulkan_renderer.h"
+#include "lib/memory.h"
 
 void 
 renderer_init(Renderer *renderer, struct Window_State *window) {
+    Renderer_Settings *settings = &renderer->settings;
+    if (!settings->vertex_buffer_size) {
+        settings->vertex_buffer_size = RENDERER_DEFAULT_VERTEX_BUFFER_SIZE;
+    }
+    if (!settings->index_buffer_size) {
+        settings->index_buffer_size = RENDERER_DEFAULT_INDEX_BUFFER_SIZE;
+    }
+    // Vertices and indices are written anew every frame and read in random order, so buffers are
+    // not zeroed and are backed by huge pages
+    Renderer_Commands *commands = &renderer->commands;
+    commands->max_vertex_count = settings->vertex_buffer_size / sizeof(Vertex);
+    commands->vertices = mem_alloc_uninit_tagged(commands->max_vertex_count * sizeof(Vertex), 
+        MEMORY_TAG_GENERAL | MEMORY_FLAG_HUGE_PAGES);
+    commands->max_index_count = settings->index_buffer_size / sizeof(RENDERER_INDEX_TYPE);
+    commands->indices = mem_alloc_uninit_tagged(commands->max_index_count * sizeof(RENDERER_INDEX_TYPE), 
+        MEMORY_TAG_GENERAL | MEMORY_FLAG_HUGE_PAGES);
     vulkan_init(renderer, window);
 }
 
+void 
+renderer_shutdown(Renderer *renderer) {
+    Renderer_Commands *commands = &renderer->commands;
+    mem_free(commands->vertices, commands->max_vertex_count * sizeof(Vertex));
+    mem_free(commands->indices, commands->max_index_count * sizeof(RENDERER_INDEX_TYPE));
+}
+
 void 
 renderer_execute_commands(Renderer *renderer, Renderer_Commands *commands) {
     vulkan_execute_commands(renderer, commands);
@@ -6,6 +6,7 @@ Version: 0
 */
 #pragma once 
 #include "lib/general.h"
+#include "lib/utils.h"
 #include "math/vec.h"
 
 #define RENDERER_INDEX_TYPE u16
@@ -24,6 +25,10 @@ typedef struct {
     u16 tex;
 } Vertex;
 
+// Used when size in Renderer_Settings is 0
+#define RENDERER_DEFAULT_VERTEX_BUFFER_SIZE MB(16)
+#define RENDERER_DEFAULT_INDEX_BUFFER_SIZE MB(4)
+
 typedef struct {
     Vec2 display_size;
     u64 vertex_buffer_size;
@@ -57,5 +62,8 @@ typedef struct Renderer {
     Renderer_Settings settings;
 } Renderer;
 
+// Allocate commands storage with sizes from settings and initialize backend
 void renderer_init(Renderer *renderer, struct Window_State *window);
+// Free commands storage
+void renderer_shutdown(Renderer *renderer);
 void renderer_execute_commands(Renderer *renderer, Renderer_Commands *commands);
\ No newline at end of file
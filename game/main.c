@@ -15,7 +15,16 @@ const uptr GAME_MODULE_FUNCTIONS_COUNT = ARRAY_SIZE(GAME_MODULE_FUNCTION_NAMES);
 
 static void 
 init_ctx() {
-    ctx.filesystem = create_filesystem();
+    // Engine arenas are long-lived and frame arenas are accessed all over every frame, 
+    // so their blocks are backed by huge pages
+    ctx.arena.alloc_flags = MEMORY_FLAG_HUGE_PAGES;
+    for (u32 i = 0; i < ARRAY_SIZE(ctx.frame_arenas); ++i) {
+        ctx.frame_arenas[i].alloc_flags = MEMORY_FLAG_HUGE_PAGES;
+    }
+    init_string_table(&ctx.strings);
+    // Thread that adds jobs also executes them, so one less worker is needed
+    init_work_queue(&ctx.work_queue, os_get_cpu_count() - 1);
+    ctx.filesystem = create_filesystem(&ctx.arena, &ctx.strings);
     
     char buffer[4096];
     uptr executable_path_len = os_fmt_executable_path(buffer, sizeof(buffer));
@@ -31,10 +40,9 @@ init_ctx() {
     buffer[folder_len] = 0;
     os_chdir(buffer);
     os_fmt_cwd(buffer, sizeof(buffer));
-    // @LEAK
-    ctx.executable_folder = mem_alloc_str(buffer);
+    ctx.executable_folder = arena_push_str(&ctx.arena, buffer);
     
-    ctx.logging_state = create_logging_state("game.log");
+    ctx.logging_state = create_logging_state(&ctx.arena, "game.log");
     log_info("Executabel folder: '%s'", ctx.executable_folder);
 }
 
@@ -46,12 +54,10 @@ init_game_hotloading(Game_Module_Functions *game_functions, Code_Hotloading_Modu
     char buffer[4096];
     engine_ctx_fmt_local_filepath(buffer, sizeof(buffer), 
         &ctx, "game.dylib");
-    // @LEAK
-    module->dll_path = mem_alloc_str(buffer);
+    module->dll_path = arena_push_str(&ctx.arena, buffer);
     engine_ctx_fmt_local_filepath(buffer, sizeof(buffer),
         &ctx, "lock.tmp");
-    // @LEAK
-    module->lock_path = mem_alloc_str(buffer);
+    module->lock_path = arena_push_str(&ctx.arena, buffer);
     log_info("Game code path '%s'", module->dll_path);
     log_info("Game code lock path '%s'", module->lock_path);
     code_hotload(module);
@@ -70,6 +76,7 @@ int main(void) {
     init_game_hotloading(&game_functions, &game_module);
     
     for (;;) {
+        engine_ctx_begin_frame(&ctx);
         poll_window_events(&ctx.win_state);
         bool should_end = false;
         if (game_module.is_valid) {
@@ -82,6 +89,11 @@ int main(void) {
     }
     
     shutdown_logging(ctx.logging_state);
+    renderer_shutdown(&ctx.renderer);
+    engine_ctx_shutdown(&ctx);
+#if INTERNAL_BUILD
+    mem_report_leaks();
+#endif
     return 0;
 }
 #endif
\ No newline at end of file
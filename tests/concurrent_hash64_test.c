@@ -0,0 +1,193 @@
+// Author: Holodome
+// Date: 17.10.2021
+// File: tests/concurrent_hash64_test.c
+// Version: 0
+//
+// Stress test of Concurrent_Hash64.
+// Table starts as small as possible, so almost every operation runs while some table is being migrated.
+// More threads than cores are used, so threads get preempted at arbitrary points of migration.
+// Phases:
+// owned - each writer thread sets, reads back and deletes keys of its own range, so it knows exactly
+//   what get must return. Reader threads at the same time read keys of all ranges and check that value
+//   is either missing or one that was written for that key
+// shared - all threads call get_or_insert on same keys with different values, and all must get value of
+//   single winner, which is also what stays in table
+// Returns nonzero on failure.
+#include "lib/general.h"
+#include "lib/hashing.h"
+#include "lib/strings.h"
+#include "platform/os.h"
+
+#include <stdatomic.h>
+
+#define TEST_WRITER_COUNT 6
+#define TEST_READER_COUNT 2
+#define TEST_THREAD_COUNT (TEST_WRITER_COUNT + TEST_READER_COUNT)
+#define TEST_KEYS_PER_THREAD 50000
+#define TEST_ROUND_COUNT 8
+#define TEST_SHARED_KEY_COUNT 200000
+#define TEST_MISSING ((u64)-2)
+#define TEST_MAX_REPORTED_FAILURES 16
+
+static _Atomic(u32) test_failure_count;
+static _Atomic(u32) test_writers_done;
+
+#define TEST_CHECK(_expr, ...) \
+do { \
+    if (!(_expr)) { \
+        if (atomic_fetch_add(&test_failure_count, 1) < TEST_MAX_REPORTED_FAILURES) { \
+            outf("%s:%d: check failed: %s: ", __FILE__, __LINE__, #_expr); \
+            outf(__VA_ARGS__); \
+            outf("\n"); \
+        } \
+    } \
+} while (0)
+
+// Key ranges of threads don't intersect, and keys are never 0 or (u64)-1
+static u64
+test_owned_key(u32 thread_idx, u32 key_idx) {
+    return ((u64)(thread_idx + 1) << 32) | (key_idx + 1);
+}
+
+// Value tells key it was written for, so readers can validate values of keys they don't own
+static u64
+test_owned_value(u64 key, u32 round) {
+    return (key << 8) | round;
+}
+
+typedef struct {
+    Concurrent_Hash64 *hash;
+    u32 thread_idx;
+    u64 *shared_results;
+} Test_Thread_Data;
+
+static OS_THREAD_PROC_SIGNATURE(test_owned_writer_proc) {
+    Test_Thread_Data *thread_data = data;
+    Concurrent_Hash64 *hash = thread_data->hash;
+    u32 thread_idx = thread_data->thread_idx;
+    for (u32 round = 0; round < TEST_ROUND_COUNT; ++round) {
+        for (u32 key_idx = 0; key_idx < TEST_KEYS_PER_THREAD; ++key_idx) {
+            u64 key = test_owned_key(thread_idx, key_idx);
+            u64 value = test_owned_value(key, round);
+            concurrent_hash64_set(hash, key, value);
+            u64 got = concurrent_hash64_get(hash, key, TEST_MISSING);
+            TEST_CHECK(got == value, "key %llx value %llx", (unsigned long long)key, (unsigned long long)got);
+        }
+        // Delete keys with odd index, keys with even index must not be affected
+        for (u32 key_idx = 1; key_idx < TEST_KEYS_PER_THREAD; key_idx += 2) {
+            u64 key = test_owned_key(thread_idx, key_idx);
+            TEST_CHECK(concurrent_hash64_delete(hash, key), "key %llx", (unsigned long long)key);
+            TEST_CHECK(!concurrent_hash64_delete(hash, key), "key %llx", (unsigned long long)key);
+        }
+        for (u32 key_idx = 0; key_idx < TEST_KEYS_PER_THREAD; ++key_idx) {
+            u64 key = test_owned_key(thread_idx, key_idx);
+            u64 expected = (key_idx & 1) ? TEST_MISSING : test_owned_value(key, round);
+            u64 got = concurrent_hash64_get(hash, key, TEST_MISSING);
+            TEST_CHECK(got == expected, "key %llx value %llx expected %llx", (unsigned long long)key,
+                (unsigned long long)got, (unsigned long long)expected);
+        }
+        // Deleted keys can be inserted again
+        for (u32 key_idx = 1; key_idx < TEST_KEYS_PER_THREAD; key_idx += 2) {
+            u64 key = test_owned_key(thread_idx, key_idx);
+            u64 value = test_owned_value(key, round);
+            u64 got = concurrent_hash64_get_or_insert(hash, key, value);
+            TEST_CHECK(got == value, "key %llx value %llx", (unsigned long long)key, (unsigned long long)got);
+        }
+    }
+    atomic_fetch_add(&test_writers_done, 1);
+}
+
+static OS_THREAD_PROC_SIGNATURE(test_owned_reader_proc) {
+    Test_Thread_Data *thread_data = data;
+    Concurrent_Hash64 *hash = thread_data->hash;
+    u64 state = thread_data->thread_idx + 1;
+    while (atomic_load(&test_writers_done) != TEST_WRITER_COUNT) {
+        state = state * 6364136223846793005llu + 1442695040888963407llu;
+        u32 thread_idx = (u32)(state >> 60) % TEST_WRITER_COUNT;
+        u32 key_idx = (u32)(state >> 20) % TEST_KEYS_PER_THREAD;
+        u64 key = test_owned_key(thread_idx, key_idx);
+        u64 got = concurrent_hash64_get(hash, key, TEST_MISSING);
+        TEST_CHECK(got == TEST_MISSING || (got >> 8) == key, "key %llx value %llx",
+            (unsigned long long)key, (unsigned long long)got);
+    }
+}
+
+static OS_THREAD_PROC_SIGNATURE(test_shared_proc) {
+    Test_Thread_Data *thread_data = data;
+    Concurrent_Hash64 *hash = thread_data->hash;
+    // Threads walk keys in different directions, so some of them meet in the middle of range
+    for (u32 idx = 0; idx < TEST_SHARED_KEY_COUNT; ++idx) {
+        u32 key_idx = (thread_data->thread_idx & 1) ? TEST_SHARED_KEY_COUNT - 1 - idx : idx;
+        u64 key = (u64)key_idx + 1;
+        u64 value = ((u64)thread_data->thread_idx << 32) | key_idx;
+        thread_data->shared_results[key_idx] = concurrent_hash64_get_or_insert(hash, key, value);
+    }
+}
+
+static void
+test_run_threads(Test_Thread_Data *thread_data, OS_Thread_Proc *writer_proc, u32 writer_count,
+                 OS_Thread_Proc *reader_proc) {
+    OS_Thread threads[TEST_THREAD_COUNT];
+    for (u32 thread_idx = 0; thread_idx < TEST_THREAD_COUNT; ++thread_idx) {
+        OS_Thread_Proc *proc = thread_idx < writer_count ? writer_proc : reader_proc;
+        threads[thread_idx] = os_create_thread(proc, thread_data + thread_idx);
+    }
+    for (u32 thread_idx = 0; thread_idx < TEST_THREAD_COUNT; ++thread_idx) {
+        os_join_thread(threads[thread_idx]);
+    }
+}
+
+int
+main(void) {
+    static u64 shared_results[TEST_THREAD_COUNT][TEST_SHARED_KEY_COUNT];
+    Test_Thread_Data thread_data[TEST_THREAD_COUNT];
+    Concurrent_Hash64 hash;
+
+    init_concurrent_hash64(&hash, 0);
+    for (u32 thread_idx = 0; thread_idx < TEST_THREAD_COUNT; ++thread_idx) {
+        thread_data[thread_idx].hash = &hash;
+        thread_data[thread_idx].thread_idx = thread_idx;
+        thread_data[thread_idx].shared_results = shared_results[thread_idx];
+    }
+    test_run_threads(thread_data, test_owned_writer_proc, TEST_WRITER_COUNT, test_owned_reader_proc);
+    // Every key is present after last round, with value of last round
+    u32 expected_count = TEST_WRITER_COUNT * TEST_KEYS_PER_THREAD;
+    TEST_CHECK(concurrent_hash64_count(&hash) == expected_count, "count %u expected %u",
+        concurrent_hash64_count(&hash), expected_count);
+    for (u32 thread_idx = 0; thread_idx < TEST_WRITER_COUNT; ++thread_idx) {
+        for (u32 key_idx = 0; key_idx < TEST_KEYS_PER_THREAD; ++key_idx) {
+            u64 key = test_owned_key(thread_idx, key_idx);
+            u64 expected = test_owned_value(key, TEST_ROUND_COUNT - 1);
+            u64 got = concurrent_hash64_get(&hash, key, TEST_MISSING);
+            TEST_CHECK(got == expected, "key %llx value %llx expected %llx", (unsigned long long)key,
+                (unsigned long long)got, (unsigned long long)expected);
+        }
+    }
+    destroy_concurrent_hash64(&hash);
+
+    init_concurrent_hash64(&hash, 0);
+    test_run_threads(thread_data, test_shared_proc, TEST_THREAD_COUNT, 0);
+    TEST_CHECK(concurrent_hash64_count(&hash) == TEST_SHARED_KEY_COUNT, "count %u expected %u",
+        concurrent_hash64_count(&hash), TEST_SHARED_KEY_COUNT);
+    for (u32 key_idx = 0; key_idx < TEST_SHARED_KEY_COUNT; ++key_idx) {
+        u64 winner = shared_results[0][key_idx];
+        TEST_CHECK((u32)winner == key_idx, "key %u value %llx", key_idx, (unsigned long long)winner);
+        for (u32 thread_idx = 1; thread_idx < TEST_THREAD_COUNT; ++thread_idx) {
+            TEST_CHECK(shared_results[thread_idx][key_idx] == winner, "key %u thread %u value %llx winner %llx",
+                key_idx, thread_idx, (unsigned long long)shared_results[thread_idx][key_idx],
+                (unsigned long long)winner);
+        }
+        u64 got = concurrent_hash64_get(&hash, (u64)key_idx + 1, TEST_MISSING);
+        TEST_CHECK(got == winner, "key %u value %llx winner %llx", key_idx, (unsigned long long)got,
+            (unsigned long long)winner);
+    }
+    destroy_concurrent_hash64(&hash);
+
+    u32 failure_count = atomic_load(&test_failure_count);
+    if (failure_count) {
+        outf("concurrent_hash64_test: %u checks failed\n", failure_count);
+    } else {
+        outf("concurrent_hash64_test: ok\n");
+    }
+    return failure_count != 0;
+}